@@ -0,0 +1,96 @@
+#include "AssetLoader.h"
+#include <chrono>
+#include <thread>
+#include <iostream>
+
+void AsyncGameObject::SetPosition(const Physics::MyVector& newPosition) {
+    position = newPosition;
+    if (IsReady()) object->SetPosition(position);
+}
+
+void AsyncGameObject::SetScale(const Physics::MyVector& newScale) {
+    scale = newScale;
+    if (IsReady()) object->SetScale(scale);
+}
+
+void AsyncGameObject::SetColor(const glm::vec3& newColor) {
+    color = newColor;
+    if (IsReady()) object->SetColor(color);
+}
+
+void AsyncGameObject::Render(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix) const {
+    if (IsReady()) {
+        object->Render(viewMatrix, projectionMatrix);
+        return;
+    }
+    if (failed || !placeholder) return;
+
+    //the placeholder is shared so it takes this object's transform just for this draw
+    placeholder->SetPosition(position);
+    placeholder->SetScale(scale);
+    placeholder->SetColor(color * 0.5f);
+    placeholder->Render(viewMatrix, projectionMatrix);
+}
+
+AssetLoader::AssetLoader(Physics::ThreadPool& pool, Shader& placeholderShader, const std::string& placeholderPath)
+    : pool(pool), placeholder(placeholderPath, placeholderShader) {
+}
+
+AssetLoader::~AssetLoader() {
+    //parse tasks still in flight push into this loader
+    while (parsing.load() > 0) {
+        std::this_thread::yield();
+    }
+}
+
+AssetLoader::Handle AssetLoader::LoadAsync(const std::string& modelPath, Shader& shader, const glm::vec3& color) {
+    Handle handle = std::make_shared<AsyncGameObject>();
+    handle->placeholder = &placeholder;
+    handle->shader = &shader;
+    handle->color = color;
+
+    parsing++;
+    pool.Submit([this, modelPath, handle]() {
+        try {
+            std::shared_ptr<const GameObject::MeshData> mesh = GameObject::LoadMeshData(modelPath);
+            std::lock_guard<std::mutex> lock(uploadMutex);
+            uploads.push_back({ handle, mesh });
+        }
+        catch (const std::exception& e) {
+            std::cout << "ERROR::ASSET::FAILED_TO_LOAD: " << modelPath << " " << e.what() << std::endl;
+            handle->failed = true;
+        }
+        parsing--;
+    });
+
+    return handle;
+}
+
+void AssetLoader::ProcessUploads(float budgetMs) {
+    using clock = std::chrono::steady_clock;
+    auto start = clock::now();
+
+    while (true) {
+        ParsedModel parsed;
+        {
+            std::lock_guard<std::mutex> lock(uploadMutex);
+            if (uploads.empty()) return;
+            parsed = std::move(uploads.front());
+            uploads.pop_front();
+        }
+
+        AsyncGameObject& target = *parsed.handle;
+        target.object.reset(new GameObject(*parsed.mesh, *target.shader, target.color));
+        target.object->SetPosition(target.position);
+        target.object->SetScale(target.scale);
+        target.ready = true;
+
+        float elapsedMs = std::chrono::duration<float, std::milli>(clock::now() - start).count();
+        if (elapsedMs >= budgetMs) return;
+    }
+}
+
+size_t AssetLoader::PendingCount() {
+    std::lock_guard<std::mutex> lock(uploadMutex);
+    return parsing.load() + uploads.size();
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <string>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include "GameObject.h"
+#include "p6/ThreadPool.h"
+
+//GameObject that may still be loading, draws a placeholder until the real model is on the GPU
+class AsyncGameObject {
+public:
+    bool IsReady() const { return ready.load(); }
+    bool HasFailed() const { return failed.load(); }
+    //nullptr until ready
+    GameObject* Get() { return IsReady() ? object.get() : nullptr; }
+
+    //transform and color are kept here and handed to the model once it arrives
+    void SetPosition(const Physics::MyVector& newPosition);
+    void SetScale(const Physics::MyVector& newScale);
+    void SetColor(const glm::vec3& newColor);
+
+    void Render(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix) const;
+
+private:
+    friend class AssetLoader;
+
+    std::unique_ptr<GameObject> object;
+    GameObject* placeholder = nullptr;
+    Shader* shader = nullptr;
+
+    Physics::MyVector position = Physics::MyVector(0, 0, 0);
+    Physics::MyVector scale = Physics::MyVector(1, 1, 1);
+    glm::vec3 color = glm::vec3(1.0f);
+
+    std::atomic<bool> ready{ false };
+    std::atomic<bool> failed{ false };
+};
+
+//loads models without hitching the frame
+//OBJ parsing and LOD generation run on the thread pool, GL buffers are created on the
+//render thread inside ProcessUploads with a per frame time budget
+class AssetLoader {
+public:
+    typedef std::shared_ptr<AsyncGameObject> Handle;
+
+    //placeholderPath is loaded right away and drawn for every model still in flight
+    AssetLoader(Physics::ThreadPool& pool, Shader& placeholderShader, const std::string& placeholderPath = "3D/myCube.obj");
+    ~AssetLoader();
+
+    AssetLoader(const AssetLoader&) = delete;
+    AssetLoader& operator=(const AssetLoader&) = delete;
+
+    //returns straight away, the handle renders the placeholder until it is ready
+    Handle LoadAsync(const std::string& modelPath, Shader& shader, const glm::vec3& color = glm::vec3(1.0f));
+
+    //render thread only, creates GL buffers for parsed models until budgetMs is spent (at least one per call)
+    void ProcessUploads(float budgetMs = 2.0f);
+
+    //loads still parsing or waiting for upload
+    size_t PendingCount();
+
+private:
+    struct ParsedModel {
+        Handle handle;
+        std::shared_ptr<const GameObject::MeshData> mesh;
+    };
+
+    Physics::ThreadPool& pool;
+    GameObject placeholder;
+
+    std::mutex uploadMutex;
+    std::deque<ParsedModel> uploads;
+    std::atomic<size_t> parsing{ 0 };
+};
@@ -0,0 +1,96 @@
+#include "Frustum.h"
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#include <emmintrin.h>
+#define FRUSTUM_SSE 1
+#endif
+
+Frustum::Frustum()
+{
+	for (int i = 0; i < 6; i++) {
+		this->planes[i] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f); //accepts everything
+	}
+}
+
+Frustum::Frustum(const glm::mat4& viewProjection)
+{
+	Extract(viewProjection);
+}
+
+void Frustum::Extract(const glm::mat4& viewProjection)
+{
+	//glm is column major so row i is (m[0][i], m[1][i], m[2][i], m[3][i])
+	glm::vec4 row[4];
+	for (int i = 0; i < 4; i++) {
+		row[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+	}
+
+	this->planes[0] = row[3] + row[0]; //left
+	this->planes[1] = row[3] - row[0]; //right
+	this->planes[2] = row[3] + row[1]; //bottom
+	this->planes[3] = row[3] - row[1]; //top
+	this->planes[4] = row[3] + row[2]; //near
+	this->planes[5] = row[3] - row[2]; //far
+
+	//normalize so distances are in world units and can be compared to radii
+	for (int i = 0; i < 6; i++) {
+		float length = glm::length(glm::vec3(this->planes[i]));
+		if (length > 0.0f) this->planes[i] /= length;
+	}
+}
+
+bool Frustum::ContainsSphere(const glm::vec3& center, float radius) const
+{
+	for (int i = 0; i < 6; i++) {
+		if (glm::dot(glm::vec3(this->planes[i]), center) + this->planes[i].w < -radius) return false;
+	}
+	return true;
+}
+
+void Frustum::CullSpheres(const float* x, const float* y, const float* z, const float* radius,
+	size_t count, std::vector<uint32_t>& visible) const
+{
+	visible.clear();
+	size_t i = 0;
+
+#ifdef FRUSTUM_SSE
+	__m128 nx[6], ny[6], nz[6], d[6];
+	for (int p = 0; p < 6; p++) {
+		nx[p] = _mm_set1_ps(this->planes[p].x);
+		ny[p] = _mm_set1_ps(this->planes[p].y);
+		nz[p] = _mm_set1_ps(this->planes[p].z);
+		d[p] = _mm_set1_ps(this->planes[p].w);
+	}
+
+	for (; i + 4 <= count; i += 4) {
+		__m128 px = _mm_loadu_ps(x + i);
+		__m128 py = _mm_loadu_ps(y + i);
+		__m128 pz = _mm_loadu_ps(z + i);
+		__m128 negR = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(radius + i));
+
+		//a lane stays set only while it is in front of every plane
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (int p = 0; p < 6; p++) {
+			__m128 dist = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(nx[p], px), _mm_mul_ps(ny[p], py)),
+				_mm_add_ps(_mm_mul_ps(nz[p], pz), d[p]));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(dist, negR));
+		}
+
+		int mask = _mm_movemask_ps(inside);
+		while (mask) {
+			int lane = 0;
+			while (!(mask & (1 << lane))) lane++;
+			visible.push_back(static_cast<uint32_t>(i + lane));
+			mask &= mask - 1;
+		}
+	}
+#endif
+
+	//scalar tail, or the whole range without SSE
+	for (; i < count; i++) {
+		if (ContainsSphere(glm::vec3(x[i], y[i], z[i]), radius[i])) {
+			visible.push_back(static_cast<uint32_t>(i));
+		}
+	}
+}
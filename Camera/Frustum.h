@@ -0,0 +1,26 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+class Frustum
+{
+	public:
+		//planes stored as (normal, distance), a point is inside when dot(normal, p) + distance >= 0
+		//order is left, right, bottom, top, near, far
+		glm::vec4 planes[6];
+
+		Frustum();
+		explicit Frustum(const glm::mat4& viewProjection);
+
+		//pulls the six planes out of a view projection matrix
+		void Extract(const glm::mat4& viewProjection);
+
+		bool ContainsSphere(const glm::vec3& center, float radius) const;
+
+		//tests spheres stored as separate arrays and appends the index of every visible one
+		//visible is cleared first, four spheres are tested at a time when SSE is available
+		void CullSpheres(const float* x, const float* y, const float* z, const float* radius,
+			size_t count, std::vector<uint32_t>& visible) const;
+};
@@ -17,16 +17,28 @@ void MyCamera::CameraMovement(glm::vec3 movement)
 
 void MyCamera::setCameraPosition(glm::vec3 position)
 {
+	//same spot, keep the cached matrices
+	if (position == this->cameraPos) return;
 	this->cameraPos = position;
 	SetViewMatrix();
 }
 
 void MyCamera::setCenter(glm::vec3 orientation)
 {
+	if (orientation == this->orientation) return;
 	this->orientation = orientation;
 	SetViewMatrix();
 }
 
+void MyCamera::SetViewport(float width, float height)
+{
+	if (width <= 0.0f || height <= 0.0f) return; //minimized window
+	if (width == this->viewportWidth && height == this->viewportHeight) return;
+	this->viewportWidth = width;
+	this->viewportHeight = height;
+	MarkProjectionDirty();
+}
+
 void MyCamera::Update(GLFWwindow* window, float time)
 {
     float cameraSpeed = 2.5f * time;
@@ -71,5 +83,86 @@ void MyCamera::Update(GLFWwindow* window, float time)
 
 void MyCamera::SetViewMatrix()
 {
+	this->viewDirty = true;
+	this->combinedDirty = true;
+}
+
+void MyCamera::MarkProjectionDirty()
+{
+	this->projectionDirty = true;
+	this->combinedDirty = true;
+}
+
+void MyCamera::RefreshView() const
+{
+	if (!this->viewDirty) return;
 	this->view_matrix = glm::lookAt(this->cameraPos, this->orientation, up);
+	this->inverseView = glm::inverse(this->view_matrix);
+	this->viewDirty = false;
+}
+
+void MyCamera::RefreshProjection() const
+{
+	if (!this->projectionDirty) return;
+	this->projectionMatrix = ComputeProjection();
+	this->inverseProjection = glm::inverse(this->projectionMatrix);
+	this->projectionDirty = false;
+}
+
+void MyCamera::RefreshCombined() const
+{
+	RefreshView();
+	RefreshProjection();
+	if (!this->combinedDirty) return;
+	this->viewProjection = this->projectionMatrix * this->view_matrix;
+	this->inverseViewProjection = this->inverseView * this->inverseProjection;
+	this->frustum.Extract(this->viewProjection);
+	this->combinedDirty = false;
+}
+
+const glm::mat4& MyCamera::GetViewMatrix() const
+{
+	RefreshView();
+	return this->view_matrix;
+}
+
+const glm::mat4& MyCamera::GetProjectionMatrix() const
+{
+	RefreshProjection();
+	return this->projectionMatrix;
+}
+
+const glm::mat4& MyCamera::GetViewProjection() const
+{
+	RefreshCombined();
+	return this->viewProjection;
+}
+
+const glm::mat4& MyCamera::GetInverseView() const
+{
+	RefreshView();
+	return this->inverseView;
+}
+
+const glm::mat4& MyCamera::GetInverseProjection() const
+{
+	RefreshProjection();
+	return this->inverseProjection;
+}
+
+const glm::mat4& MyCamera::GetInverseViewProjection() const
+{
+	RefreshCombined();
+	return this->inverseViewProjection;
+}
+
+const Frustum& MyCamera::GetFrustum() const
+{
+	RefreshCombined();
+	return this->frustum;
+}
+
+float MyCamera::GetPixelScale() const
+{
+	return GetProjectionMatrix()[1][1] * this->viewportHeight * 0.5f;
 }
@@ -3,29 +3,69 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <GLFW/glfw3.h>
+#include "Frustum.h"
 
+//base camera, owns the view and caches everything derived from it
+//matrices and frustum are only rebuilt on the first read after the camera or viewport changed
 class MyCamera
 {
     protected:
         glm::vec3 cameraPos;
         glm::vec3 orientation;
         glm::vec3 up;
-        glm::mat4 view_matrix;
 
+        float viewportWidth = 800.0f;
+        float viewportHeight = 800.0f;
 
         glm::mat4 identity_matrix = glm::mat4(1.f);
     public:
         MyCamera();
+        virtual ~MyCamera() {}
 
         void CameraMovement(glm::vec3 movement);
         void setCameraPosition(glm::vec3 position);
         void setCenter(glm::vec3 orientation);
+        //viewport in pixels, changes the aspect ratio and pixel scale
+        void SetViewport(float width, float height);
 
         virtual void Update(GLFWwindow* window, float time);
     public:
+        //marks the view as changed, kept for code that moves the camera fields directly
         void SetViewMatrix();
-        glm::mat4 GetViewMatrix() const { return view_matrix; };
-    public:
-        virtual glm::mat4 getViewProjection() const = 0;
-};
 
+        glm::vec3 GetPosition() const { return cameraPos; }
+        float GetViewportHeight() const { return viewportHeight; }
+
+        const glm::mat4& GetViewMatrix() const;
+        const glm::mat4& GetProjectionMatrix() const;
+        const glm::mat4& GetViewProjection() const;
+        const glm::mat4& GetInverseView() const;
+        const glm::mat4& GetInverseProjection() const;
+        const glm::mat4& GetInverseViewProjection() const;
+        const Frustum& GetFrustum() const;
+        //projection[1][1] * viewport height / 2, turns world radii into pixels
+        float GetPixelScale() const;
+
+        glm::mat4 getViewProjection() const { return GetViewProjection(); }
+    protected:
+        //subclasses build their projection here and call MarkProjectionDirty when its inputs change
+        virtual glm::mat4 ComputeProjection() const = 0;
+        void MarkProjectionDirty();
+
+    private:
+        void RefreshView() const;
+        void RefreshProjection() const;
+        void RefreshCombined() const;
+
+        mutable glm::mat4 view_matrix;
+        mutable glm::mat4 inverseView;
+        mutable glm::mat4 projectionMatrix;
+        mutable glm::mat4 inverseProjection;
+        mutable glm::mat4 viewProjection;
+        mutable glm::mat4 inverseViewProjection;
+        mutable Frustum frustum;
+
+        mutable bool viewDirty = true;
+        mutable bool projectionDirty = true;
+        mutable bool combinedDirty = true;
+};
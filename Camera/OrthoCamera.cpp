@@ -1,13 +1,26 @@
 #include "OrthoCamera.h"
 
-OrthoCamera::OrthoCamera() : MyCamera()
+OrthoCamera::OrthoCamera() : OrthoCamera(-400.f, 400.f, -400.f, 400.f, -400.f, 400.f)
 {
-	
-	this->projectionMatrix = glm::ortho(-400.f, 400.f, -400.f, 400.f, -400.f, 400.f);
-	this->viewMatrix = glm::mat4(1.0f); // Initialize as identity matrix
 }
 
-glm::mat4 OrthoCamera::getViewProjection() const
+OrthoCamera::OrthoCamera(float left, float right, float bottom, float top, float nearPlane, float farPlane)
+	: MyCamera(), left(left), right(right), bottom(bottom), top(top), nearPlane(nearPlane), farPlane(farPlane)
 {
-	return projectionMatrix * viewMatrix;
+}
+
+void OrthoCamera::SetBounds(float left, float right, float bottom, float top, float nearPlane, float farPlane)
+{
+	this->left = left;
+	this->right = right;
+	this->bottom = bottom;
+	this->top = top;
+	this->nearPlane = nearPlane;
+	this->farPlane = farPlane;
+	MarkProjectionDirty();
+}
+
+glm::mat4 OrthoCamera::ComputeProjection() const
+{
+	return glm::ortho(left, right, bottom, top, nearPlane, farPlane);
 }
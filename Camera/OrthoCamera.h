@@ -3,10 +3,12 @@
 
 class OrthoCamera : public MyCamera
 {
+	private:
+		float left, right, bottom, top, nearPlane, farPlane;
 	public:
-		glm::mat4 projectionMatrix;
-		glm::mat4 viewMatrix;
 		OrthoCamera();
-		glm::mat4 getViewProjection() const;
+		OrthoCamera(float left, float right, float bottom, float top, float nearPlane, float farPlane);
+		void SetBounds(float left, float right, float bottom, float top, float nearPlane, float farPlane);
+	protected:
+		glm::mat4 ComputeProjection() const override;
 };
-
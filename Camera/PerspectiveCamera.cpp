@@ -1,30 +1,23 @@
 #include "PerspectiveCamera.h"
 #include <iostream>
 
-PerspectiveCamera::PerspectiveCamera() : MyCamera()
+PerspectiveCamera::PerspectiveCamera() : PerspectiveCamera(45.f, 0.1f, 2000.0f)
 {
-	this->window_height = 800;
-	this->window_width = 800;
-	this->theta = 45.5f;
-	this->phi = 89.5f;
-	this->aspectRatio = static_cast<float>(window_height) / static_cast<float>(window_width);
-	this->SetProjectionMatrix(45.f);
-	viewMatrix = glm::mat4(1.0f); // Initialize as identity matrix
 }
 
-glm::mat4 PerspectiveCamera::getViewProjection() const
+PerspectiveCamera::PerspectiveCamera(float viewAngle, float nearPlane, float farPlane)
+	: MyCamera(), fieldOfView(viewAngle), nearPlane(nearPlane), farPlane(farPlane)
 {
-	return projectionMatrix * viewMatrix;
 }
 
 void PerspectiveCamera::SetProjectionMatrix(float viewAngle)
 {
-	//dont edit anymore
-	this->projectionMatrix = glm::perspective(glm::radians(viewAngle), this->aspectRatio, 0.1f, 2000.0f);
+	if (viewAngle == this->fieldOfView) return;
+	this->fieldOfView = viewAngle;
+	MarkProjectionDirty();
 }
 
-
-
-
-
-
+glm::mat4 PerspectiveCamera::ComputeProjection() const
+{
+	return glm::perspective(glm::radians(this->fieldOfView), this->viewportWidth / this->viewportHeight, this->nearPlane, this->farPlane);
+}
@@ -6,17 +6,14 @@ class PerspectiveCamera :
     public MyCamera
 {
 	private:
-		glm::mat4 projectionMatrix;
-		glm::mat4 viewMatrix;
-		float window_width;
-		float window_height;
-		float aspectRatio;
-		float theta;
-		float phi;
+		float fieldOfView;
+		float nearPlane;
+		float farPlane;
 	public:
 		PerspectiveCamera();
-		glm::mat4 getViewProjection() const;
+		PerspectiveCamera(float viewAngle, float nearPlane, float farPlane);
 		void SetProjectionMatrix(float viewAngle);
-		
+	protected:
+		//aspect ratio comes from the viewport
+		glm::mat4 ComputeProjection() const override;
 };
-
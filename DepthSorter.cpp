@@ -0,0 +1,82 @@
+#include "DepthSorter.h"
+#include "p6/RadixSort.h"
+#include "p6/AllocationAudit.h"
+#include <algorithm>
+#include <limits>
+
+namespace {
+    //below this a chunk is not worth handing to another thread
+    const size_t minChunk = 16384;
+}
+
+DepthSorter::DepthSorter(Physics::ThreadPool& pool)
+    : pool(pool) {
+}
+
+void DepthSorter::SortBackToFront(const float* x, const float* y, const float* z,
+    std::vector<uint32_t>& indices, const glm::mat4& viewMatrix, Physics::FrameArena& arena) {
+    const size_t count = indices.size();
+    if (count < 2) return;
+    Physics::AllocationScope scope("depth sort");
+
+    float* depths = arena.AllocateArray<float>(count);
+    uint16_t* keys = arena.AllocateArray<uint16_t>(count);
+
+    const size_t chunkCount = std::max<size_t>(1, std::min<size_t>(pool.GetThreadCount() + 1, count / minChunk));
+    const size_t chunkSize = (count + chunkCount - 1) / chunkCount;
+    float* chunkMin = arena.AllocateArray<float>(chunkCount);
+    float* chunkMax = arena.AllocateArray<float>(chunkCount);
+    std::fill(chunkMin, chunkMin + chunkCount, std::numeric_limits<float>::max());
+    std::fill(chunkMax, chunkMax + chunkCount, std::numeric_limits<float>::lowest());
+
+    //only the z row of the view matrix matters, distance in front of the camera is -z
+    const float rx = -viewMatrix[0][2];
+    const float ry = -viewMatrix[1][2];
+    const float rz = -viewMatrix[2][2];
+    const float rw = -viewMatrix[3][2];
+    const uint32_t* index = indices.data();
+
+    //generic lambda rather than std::function so the bodies are never copied to the heap
+    auto forEachChunk = [&](const auto& body) {
+        if (chunkCount == 1) {
+            body(0, 0, count);
+            return;
+        }
+        pool.ParallelFor(chunkCount, 1, [&](size_t first, size_t last) {
+            for (size_t chunk = first; chunk < last; chunk++) {
+                body(chunk, chunk * chunkSize, std::min(count, (chunk + 1) * chunkSize));
+            }
+        });
+    };
+
+    forEachChunk([&](size_t chunk, size_t begin, size_t end) {
+        float low = chunkMin[chunk];
+        float high = chunkMax[chunk];
+        for (size_t i = begin; i < end; i++) {
+            uint32_t p = index[i];
+            float depth = rx * x[p] + ry * y[p] + rz * z[p] + rw;
+            depths[i] = depth;
+            low = std::min(low, depth);
+            high = std::max(high, depth);
+        }
+        chunkMin[chunk] = low;
+        chunkMax[chunk] = high;
+    });
+
+    const float nearest = *std::min_element(chunkMin, chunkMin + chunkCount);
+    const float farthest = *std::max_element(chunkMax, chunkMax + chunkCount);
+    //everything at one depth, any order is right
+    if (farthest <= nearest) return;
+
+    //farthest gets key 0 so an ascending sort gives back to front
+    const float scale = 65535.0f / (farthest - nearest);
+    forEachChunk([&](size_t, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            keys[i] = static_cast<uint16_t>((farthest - depths[i]) * scale);
+        }
+    });
+
+    uint16_t* keyScratch = arena.AllocateArray<uint16_t>(count);
+    uint32_t* indexScratch = arena.AllocateArray<uint32_t>(count);
+    Physics::ParallelRadixSortPairs(pool, arena, keys, indices.data(), keyScratch, indexScratch, count, minChunk);
+}
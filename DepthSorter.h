@@ -0,0 +1,22 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+#include "p6/ThreadPool.h"
+#include "p6/FrameArena.h"
+
+//orders particles far to near so alpha blending composites them correctly
+//view space depth is quantized to 16 bits between the nearest and farthest particle,
+//then the index array is radix sorted on the pool in two 8 bit passes
+class DepthSorter {
+public:
+    explicit DepthSorter(Physics::ThreadPool& pool);
+
+    //reorders indices so the point (x, y, z)[index] farthest from the camera comes first
+    //depths, keys and sort buffers are taken from arena, reset it once per frame
+    void SortBackToFront(const float* x, const float* y, const float* z,
+        std::vector<uint32_t>& indices, const glm::mat4& viewMatrix, Physics::FrameArena& arena);
+
+private:
+    Physics::ThreadPool& pool;
+};
@@ -3,7 +3,9 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <iostream>
-#include <random>
+#include <algorithm>
+#include <atomic>
+#include <thread>
 
 #include <chrono>
 using namespace std::chrono_literals;
@@ -12,6 +14,16 @@ constexpr std::chrono::nanoseconds timestep(16ms);
 
 #include "GameObject.h" //andles visual objects
 #include "Shader.h" //shader program management
+#include "Camera/OrthoCamera.h" //cached camera matrices and frustum
+#include "Camera/PerspectiveCamera.h"
+#include "SpriteBatch.h" //point sprite particles
+#include "TextureCache.h" //background texture loading
+#include "AssetLoader.h" //background model loading
+#include "RenderQueue.h" //sorted draw submission
+#include "DepthSorter.h" //back to front order for blending
+#include "WeightedBlendedOit.h" //unsorted transparency for huge counts
+#include "RenderBenchmark.h" //--bench offscreen mode
+#include "SteadyStateAudit.h" //--audit allocation check
 
 //physics engine components
 #include "p6/MyVector.h"
@@ -21,20 +33,25 @@ constexpr std::chrono::nanoseconds timestep(16ms);
 #include "p6/ForceRegistry.h"
 #include "p6/GravityForceGenerator.h"
 #include "p6/DragForceGenerator.h"
+#include "p6/ForceField.h"
 #include "p6/PhaseOne/ParticleSystem.h"
+#include "p6/ParticleEmitter.h"
+#include "p6/ObjectPool.h"
+#include "p6/AllocationAudit.h"
+#include "p6/LifetimeWheel.h"
+#include "p6/ThreadPool.h"
 
 using namespace Physics;
 
-//representce a particle with both physics and visual components
+//representce a particle, visuals are drawn from the world snapshot so no GameObject here
 struct Particle {
     PhysicsParticle physics;
-    GameObject visual;
-    float lifetime;
-    float maxLifetime;
+    float birth; //absolute times on the lifetime wheel's clock
+    float death;
     glm::vec3 color;
 
-    Particle(const std::string& modelPath, Shader& shader)
-        : physics(), visual(modelPath, shader), lifetime(0), maxLifetime(0), color(1.0f) {
+    Particle()
+        : physics(), birth(0), death(0), color(1.0f) {
     }
 
     Particle(Particle&& other) noexcept = default;
@@ -58,7 +75,10 @@ int getMaxParticlesFromUser() {
 
 //global variables
 bool isPerspective = false;
-bool isPaused = false;
+bool useSprites = false; //draw particles as point sprites instead of sphere meshes
+bool useOit = false; //sprites skip the sort and use weighted blended transparency
+bool loadPillar = false; //set by the key, the render loop starts the load
+std::atomic<bool> isPaused(false); //read by the simulation thread
 float cameraDistance = 80.0f;
 float cameraRotationX = 0.0f;
 float cameraRotationY = 0.0f;
@@ -76,8 +96,23 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
         case GLFW_KEY_2:
             isPerspective = true; //switchingg to perspective
             break;
+        case GLFW_KEY_3:
+            useSprites = false; //sphere meshes
+            break;
+        case GLFW_KEY_4:
+            useSprites = true; //point sprites
+            break;
+        case GLFW_KEY_5:
+            useOit = false; //exact, sorted back to front
+            break;
+        case GLFW_KEY_6:
+            useOit = true; //approximate, order independent
+            break;
+        case GLFW_KEY_7:
+            loadPillar = true; //load another model mid session
+            break;
         case GLFW_KEY_SPACE:
-            isPaused = !isPaused; //toggling of pause  andplay
+            isPaused = !isPaused.load(); //toggling of pause  andplay
             break;
         }
     }
@@ -102,7 +137,16 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
     }
 }
 
-int main() {
+int main(int argc, char** argv) {
+    //offscreen render benchmark instead of the interactive demo
+    if (argc > 1 && std::string(argv[1]) == "--bench") {
+        return RenderBenchmark::Run(argc, argv);
+    }
+    //headless check that steady state steps never touch the heap
+    if (argc > 1 && std::string(argv[1]) == "--audit") {
+        return SteadyStateAudit::Run(argc, argv);
+    }
+
     //initializeGLFW and creating of window
     if (!glfwInit()) return -1;
     GLFWwindow* window = glfwCreateWindow(800, 800, "Group 5 - YN-GINE", NULL, NULL);
@@ -120,54 +164,203 @@ int main() {
 
     const int maxParticles = getMaxParticlesFromUser(); //gets particle count from user
 
-    Shader shader("Shaders/Sample.vert", "Shaders/Sample.frag"); //loading of shaders
+    //loading of shaders, compiled together and cached as binaries for the next launch
+    std::vector<std::unique_ptr<Shader>> programs = Shader::CompileBatch({
+        { "Shaders/Sample.vert", "Shaders/Sample.frag" },
+        { "Shaders/sprite.vert", "Shaders/sprite.frag" },
+        { "Shaders/sprite.vert", "Shaders/sprite_oit.frag" },
+        { "Shaders/oit_composite.vert", "Shaders/oit_composite.frag" },
+        { "Shaders/floor.vert", "Shaders/floor.frag" },
+    });
+    Shader& shader = *programs[0];
+    Shader& spriteShader = *programs[1];
+    Shader& spriteOitShader = *programs[2];
+    Shader& oitCompositeShader = *programs[3];
+    Shader& floorShader = *programs[4];
+
+    GameObject sphere("3D/sphere.obj", shader); //one mesh shared by every particle
+    SpriteBatch sprites(spriteShader);
+    TextureCache textures(ThreadPool::Shared()); //decoded on the pool, uploaded a bit each frame
+    AssetLoader assets(ThreadPool::Shared(), shader); //models parsed on the pool, placeholder cube until ready
+    std::vector<AssetLoader::Handle> pillars; //loaded with 7, decoration only, the spray passes through
     PhysicsWorld pWorld;
-    std::vector<Particle> particles; //container for the particles
-    particles.reserve(maxParticles);
-    MyVector spawnPoint(0, -30, 0); //initial spawn pos
-
-    //random number generators for particle properties
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<float> hueDist(0.0f, 1.0f); //co lor
-    std::uniform_real_distribution<float> sizeDist(1.0f, 5.0f); //size
-    std::uniform_real_distribution<float> lifeDist(1.0f, 10.0f); //lifespan
-    std::uniform_real_distribution<float> forceDist(800.0f, 1200.0f); //force
-    std::uniform_real_distribution<float> angleDist(0.0f, 2.0f * 3.14159265f); //direction
-    std::uniform_real_distribution<float> radiusDist(2.0f, 10.0f); //spread
-
-    //camera ssetup
-    glm::mat4 projection = glm::ortho(-80.0f, 80.0f, -80.0f, 80.0f, -80.0f, 80.0f);
-    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 10.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    //slowly shifting turbulence around the fountain, the next frame of it is built on its own thread
+    ForceField turbulence(32, 32, 32, MyVector(-100, -100, -100), MyVector(100, 100, 100));
+    turbulence.Animate([](ForceField::Grid& grid, float time) {
+        ForceField::BuildCurlNoise(grid, 1u, 0.02f, 6.0f, time);
+    }, 0.5f);
+    //gravity and turbulence for every particle in one fused pass instead of a registry entry each
+    ForcePipeline<GravityForceGenerator, ForceField*> worldForces(GravityForceGenerator(MyVector(0, -9.8f, 0)), &turbulence);
+    pWorld.SetForcePipeline(&worldForces);
+
+    //bunny over the fountain, the spray bounces off it
+    GameObject bunny("3D/bunny.obj", shader, glm::vec3(0.8f, 0.7f, 0.6f));
+    bunny.SetPosition(MyVector(0, -40, 0));
+    bunny.SetScale(MyVector(300, 300, 300));
+    MeshCollider bunnyCollider = bunny.CreateCollider();
+    pWorld.AddCollider(&bunnyCollider);
+
+    //floor under the fountain so the spray lands instead of falling forever
+    ParticleBoundary floor = ParticleBoundary::Plane(MyVector(0, 1, 0), -90.0f);
+    floor.SetRestitution(0.4f);
+    floor.SetResolveInPlace(true);
+    pWorld.AddBoundary(&floor);
+    //drawn flat until the bricks finish decoding
+    TextureCache::Handle floorTexture = textures.Load("3D/brickwall.jpg");
+    GLuint floorVAO; //the floor square is generated in the vertex shader
+    glGenVertexArrays(1, &floorVAO);
+
+    //launch speeds cover a whole collider in one tick, fast particles get swept instead
+    pWorld.SetContinuousCollision(true);
+
+    //the spray pools on the floor like a liquid instead of a heap of marbles
+    SphFluid water;
+    pWorld.AddFluid(&water);
+
+    //camera ssetup, both look at the origin and only rebuild their matrices when they move
+    OrthoCamera orthoCamera(-80.0f, 80.0f, -80.0f, 80.0f, -80.0f, 500.0f);
+    PerspectiveCamera perspectiveCamera(45.0f, 0.1f, 500.0f);
+    orthoCamera.setCenter(glm::vec3(0.0f));
+    perspectiveCamera.setCenter(glm::vec3(0.0f));
 
     glEnable(GL_DEPTH_TEST);
     glClearColor(0.1f, 0.1f, 0.1f, 1.0f); //background color
 
-    DragForceGenerator dragForce(0.2f, 0.01f); //creatin of drag forc e
+    std::atomic<bool> running(true);
+    std::vector<uint32_t> visibleParticles; //reused every frame
+    RenderQueue renderQueue; //refilled every frame
+    GLStateCache glState; //skips redundant binds
+    DepthSorter depthSorter(ThreadPool::Shared()); //orders particles for blending
+    FrameArena frameArena; //render thread scratch, rewound at the top of every frame
+    WeightedBlendedOit oit(oitCompositeShader);
+    const bool oitSupported = WeightedBlendedOit::IsSupported(); //otherwise sprites stay on the sorted path
+
+    //simulation thread, owns the particles and steps the world on a fixed tick
+    std::thread simulation([&]() {
+        ObjectPool<Particle> particles; //fixed addresses so physics pointers stay valid, slots get reused
+
+        //fountain from below the origin, a narrow upward cone with a strong launch push
+        EmitterSettings fountain;
+        fountain.shape = EmitterSettings::Shape::Cone;
+        fountain.origin = MyVector(0, -80, 0);
+        fountain.axis = MyVector(0, 1, 0);
+        fountain.coneAngle = 0.2f;
+        fountain.rate = 50.0f; //particles per second no matter the tick rate
+        fountain.force = { 7600.0f, 8400.0f };
+        fountain.lifetime = { 1.0f, 10.0f };
+        ParticleEmitter emitter(fountain);
+        SpawnBatch spawned; //reused every tick
+
+        //timing variables
+        using clock = std::chrono::steady_clock;
+        const float deltaTime = std::chrono::duration<float>(timestep).count();
+        auto nextTick = clock::now();
+        bool ParticleStart = false;
+
+        //expiry buckets, a tick only looks at the particles that die on it
+        typedef Particle* ParticleHandle;
+        LifetimeWheel<ParticleHandle> lifetimes(deltaTime);
+        std::vector<ParticleHandle> expired;
+
+        while (running) {
+            AllocationScope scope("simulation");
+
+            //checking if restarting of particle spawning is needed
+            if (ParticleStart && particles.Empty()) {
+                ParticleStart = false;
+            }
+
+            if (!isPaused) {
+                //spawn everything due this tick in one go
+                if (!ParticleStart) {
+                    emitter.Update(deltaTime, spawned, maxParticles - particles.Size());
+                    for (size_t i = 0; i < spawned.Size(); i++) {
+                        //create new particle
+                        Particle& p = *particles.Create();
+
+                        //set initial physics properties
+                        p.physics.Position = spawned.Position(i);
+                        p.physics.mass = 1.0f;
+                        p.physics.Damping = 0.9f;
+                        p.physics.Velocity = spawned.Velocity(i);
+                        p.physics.AddForce(spawned.Force(i));
+
+                        //setting of visual properties
+                        p.color = spawned.color[i];
+
+                        //set lifespan
+                        p.birth = lifetimes.Now();
+                        p.death = lifetimes.Add(&p, spawned.lifetime[i]);
+
+                        pWorld.AddParticle(&p.physics);
+                        water.AddParticle(&p.physics);
+                    }
+                    if (particles.Size() >= static_cast<size_t>(maxParticles)) {
+                        ParticleStart = true; //spawning is done
+                    }
+                }
+
+                pWorld.Update(deltaTime); //updating of physics
+                turbulence.Update(deltaTime); //swaps in the next turbulence frame once it is built
+
+                //only the particles whose time is up come back from the wheel
+                lifetimes.Advance(deltaTime, expired);
+                if (!expired.empty()) {
+                    for (ParticleHandle it : expired) {
+                        pWorld.RemoveParticle(&it->physics);
+                    }
+
+                    //world lets go of all of them at once, then they can be freed
+                    pWorld.FlushRemovals();
+                    for (ParticleHandle it : expired) {
+                        particles.Destroy(it);
+                    }
+                    expired.clear();
+                }
+            }
 
-    //timing variables
-    using clock = std::chrono::high_resolution_clock;
-    auto prev_time = clock::now();
-    float spawnTimer = 0.0f;
-    const float spawnInterval = 0.02f; //time between particle spawns
-    bool ParticleStart = false;
+            //publish what the renderer needs for this step
+            ParticleSnapshot& snapshot = pWorld.BeginSnapshot();
+            particles.ForEach([&](const Particle& p) {
+                //shrinks with remaining lifetime, worked out here instead of every particle every tick
+                float lifeRatio = lifetimes.LifeRatio(p.birth, p.death);
+                snapshot.Push(p.physics.Position, p.physics.mass * lifeRatio, p.color, lifeRatio);
+            });
+            pWorld.PublishSnapshot();
+
+            //wait for the next tick, skip ahead instead of spiralling if we fell behind
+            nextTick += timestep;
+            auto now = clock::now();
+            if (nextTick < now) nextTick = now;
+            std::this_thread::sleep_until(nextTick);
+        }
+    });
 
-    //main game loop
+    //render loop stays on the main thread since it owns the GL context
     while (!glfwWindowShouldClose(window)) {
+        AllocationScope scope("render");
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        frameArena.Reset();
+
+        //finish any texture and model loads that are ready without blowing the frame
+        textures.ProcessUploads(2.0f);
+        assets.ProcessUploads(2.0f);
+
+        //pillars go around the fountain, standing on the floor
+        if (loadPillar && pillars.size() < 8) {
+            float angle = glm::radians(45.0f) * pillars.size();
+            AssetLoader::Handle pillar = assets.LoadAsync("3D/quiz.obj", shader, glm::vec3(0.6f, 0.6f, 0.7f));
+            pillar->SetPosition(MyVector(std::sin(angle) * 70.0f, -38.6f, std::cos(angle) * 70.0f));
+            pillars.push_back(pillar);
+        }
+        loadPillar = false;
 
-        auto now = clock::now();
-        float deltaTime = std::chrono::duration<float>(now - prev_time).count();
-        prev_time = now;
+        //pick the camera for the current view mode
+        MyCamera& camera = isPerspective ? static_cast<MyCamera&>(perspectiveCamera) : static_cast<MyCamera&>(orthoCamera);
 
-        //setting up  of projection matrix based on current view mode
-        glm::mat4 projection;
-        if (isPerspective) {
-            projection = glm::perspective(glm::radians(45.0f), 1.0f, 0.1f, 500.0f);
-        }
-        else {
-            projection = glm::ortho(-80.0f, 80.0f, -80.0f, 80.0f, -80.0f, 500.0f);
-        }
+        int framebufferWidth, framebufferHeight;
+        glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+        camera.SetViewport(static_cast<float>(framebufferWidth), static_cast<float>(framebufferHeight));
 
         //calculate camera position based on rotations
         float cosY = cos(cameraRotationY);
@@ -175,100 +368,103 @@ int main() {
         float camZ = cos(cameraRotationX) * cosY * cameraDistance;
         float camY = sin(cameraRotationY) * cameraDistance;
 
-        //updating of view matrix
-        glm::vec3 cameraPos = glm::vec3(camX, camY, camZ);
-        glm::vec3 target = glm::vec3(0.0f, 0.0f, 0.0f);
-        glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
-        view = glm::lookAt(cameraPos, target, up);
+        //no-op when the camera did not orbit, the cached matrices stay valid
+        camera.setCameraPosition(glm::vec3(camX, camY, camZ));
+
+        //grab the newest finished step, keeps the old one if the sim has not ticked
+        pWorld.AcquireSnapshot();
+        const ParticleSnapshot& snapshot = pWorld.GetSnapshot();
 
-        //checking if restarting of particle spawning is needed
-        if (ParticleStart && particles.empty()) {
-            ParticleStart = false;
+        //skip particles outside the camera, the sphere mesh is unit radius so scale is the radius
+        camera.GetFrustum().CullSpheres(snapshot.x.data(), snapshot.y.data(), snapshot.z.data(), snapshot.scale.data(),
+            snapshot.Size(), visibleParticles);
+
+        //faded particles are translucent, the sorted paths draw them back to front with depth writes off
+        const bool drawOit = useSprites && useOit && oitSupported;
+        if (!drawOit) {
+            depthSorter.SortBackToFront(snapshot.x.data(), snapshot.y.data(), snapshot.z.data(),
+                visibleParticles, camera.GetViewMatrix(), frameArena);
         }
 
-        if (!isPaused) {
-            //spawn new particles
-            if (!ParticleStart) {
-                spawnTimer += deltaTime;
-                if (spawnTimer >= spawnInterval && particles.size() < maxParticles) {
-                    spawnTimer = 0.0f;
-
-                    //create new particle
-                    particles.emplace_back("3D/sphere.obj", shader);
-                    Particle& p = particles.back();
-
-                    //set initial physics properties
-                    p.physics.Position = MyVector(0, -80, 0);
-                    p.physics.mass = 1.0f;
-                    p.physics.Damping = 0.9f;
-                    p.physics.Velocity = MyVector(0, 0, 0);
-
-                    //calculate random direction for force
-                    float theta = angleDist(gen);
-                    float phi = angleDist(gen) * 0.25f;
-
-                    float forceMagnitude = 3000.0f + forceDist(gen);
-                    float sinPhi = sin(phi);
-                    float cosPhi = cos(phi);
-                    float sinTheta = sin(theta);
-                    float cosTheta = cos(theta);
-
-                    //applying of force in calculated direction
-                    MyVector forceDirection(
-                        sinPhi * cosTheta * 0.4f,
-                        cosPhi * 2.0f,
-                        sinPhi * sinTheta * 0.4f
-                    );
-
-                    p.physics.AddForce(forceDirection * forceMagnitude);
-
-                    //setting of visual properties
-                    float size = sizeDist(gen);
-                    p.visual.SetScale(MyVector(size, size, size));
-                    p.color = glm::vec3(hueDist(gen), hueDist(gen), hueDist(gen));
-                    p.visual.SetColor(glm::vec4(p.color, 1.0f));
-
-                    //set lifespan
-                    p.maxLifetime = lifeDist(gen);
-                    p.lifetime = p.maxLifetime;
-
-                    pWorld.AddParticle(&p.physics);
-                }
-                else if (particles.size() >= maxParticles) {
-                    ParticleStart = true; //spawning is done
-                }
+        //scene geometry first so the translucent particles blend over it
+        bunny.Render(camera.GetViewMatrix(), camera.GetProjectionMatrix());
+        for (const AssetLoader::Handle& pillar : pillars) {
+            pillar->Render(camera.GetViewMatrix(), camera.GetProjectionMatrix());
+        }
+
+        //tiled bricks where the floor boundary is
+        floorShader.Use();
+        floorShader.SetMat4("viewProjection", camera.GetViewProjection());
+        floorShader.SetFloat("height", -90.0f);
+        floorShader.SetFloat("halfSize", 150.0f);
+        floorShader.SetFloat("tileSize", 30.0f);
+        floorShader.SetVec3("color", glm::vec3(0.8f));
+        floorShader.SetInt("floorTexture", 0);
+        floorShader.SetInt("useTexture", floorTexture->ready ? 1 : 0);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, floorTexture->ready ? floorTexture->id : 0);
+        glBindVertexArray(floorVAO);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        glBindVertexArray(0);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glState.Invalidate();
+
+        if (useSprites) {
+            //every visible particle in a single draw, in the order they were added
+            sprites.Clear();
+            for (uint32_t i : visibleParticles) {
+                sprites.Add(glm::vec3(snapshot.x[i], snapshot.y[i], snapshot.z[i]), snapshot.scale[i],
+                    glm::vec4(snapshot.color[i], snapshot.alpha[i]));
             }
 
-            pWorld.Update(deltaTime); //updating of physics
-
-            //remove dead particles and update living ones
-            particles.erase(std::remove_if(particles.begin(), particles.end(),
-                [&](Particle& p) {
-                    p.lifetime -= deltaTime;
-                    if (p.lifetime <= 0) return true;
-
-                    //update visual properties based on remaining lifetime
-                    float lifeRatio = p.lifetime / p.maxLifetime;
-                    p.visual.SetColor(glm::vec4(p.color, lifeRatio));
-                    p.visual.SetScale(MyVector(
-                        p.physics.mass * lifeRatio,
-                        p.physics.mass * lifeRatio,
-                        p.physics.mass * lifeRatio
-                    ));
-                    return false;
-                }), particles.end());
+            if (drawOit) {
+                oit.Begin(framebufferWidth, framebufferHeight);
+                sprites.Draw(camera.GetViewMatrix(), camera.GetProjectionMatrix(), static_cast<float>(framebufferHeight), &spriteOitShader);
+                oit.End();
+            }
+            else {
+                glEnable(GL_BLEND);
+                glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+                glDepthMask(GL_FALSE);
+                sprites.Draw(camera.GetViewMatrix(), camera.GetProjectionMatrix(), static_cast<float>(framebufferHeight));
+                glDepthMask(GL_TRUE);
+                glDisable(GL_BLEND);
+            }
         }
+        else {
+            //pick a detail level from the on screen size and queue the draw
+            const glm::mat4& viewProjection = camera.GetViewProjection();
+            float pixelScale = camera.GetPixelScale();
+            renderQueue.Clear();
+            for (uint32_t i : visibleParticles) {
+                glm::vec3 center(snapshot.x[i], snapshot.y[i], snapshot.z[i]);
+                float screenRadius = GameObject::ProjectedRadius(viewProjection, pixelScale, center, snapshot.scale[i]);
+
+                sphere.SetPosition(MyVector(center.x, center.y, center.z));
+                sphere.SetScale(MyVector(snapshot.scale[i], snapshot.scale[i], snapshot.scale[i]));
+                sphere.SetColor(glm::vec4(snapshot.color[i], snapshot.alpha[i]));
+                sphere.Submit(renderQueue, camera, sphere.SelectLod(screenRadius));
+            }
 
-        //render all particles
-        for (auto& p : particles) {
-            p.visual.SetPosition(p.physics.Position);
-            p.visual.Render(view, projection);
+            //already back to front, a key sort would undo that, every particle shares one program and VAO anyway
+            renderQueue.UseSubmitOrder();
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            glDepthMask(GL_FALSE);
+            renderQueue.Execute(glState);
+            glDepthMask(GL_TRUE);
+            glDisable(GL_BLEND);
         }
 
         glfwSwapBuffers(window);
         glfwPollEvents();
     }
 
+    running = false;
+    simulation.join();
+
+    glDeleteVertexArrays(1, &floorVAO);
+
     glfwTerminate();
     return 0;
 }
\ No newline at end of file
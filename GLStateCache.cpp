@@ -0,0 +1,39 @@
+#include "GLStateCache.h"
+
+void GLStateCache::UseProgram(GLuint program) {
+    if (currentProgram == program) {
+        stats.skippedBinds++;
+        return;
+    }
+    glUseProgram(program);
+    currentProgram = program;
+    stats.programBinds++;
+}
+
+void GLStateCache::BindVertexArray(GLuint vertexArray) {
+    if (currentVertexArray == vertexArray) {
+        stats.skippedBinds++;
+        return;
+    }
+    glBindVertexArray(vertexArray);
+    currentVertexArray = vertexArray;
+    stats.vertexArrayBinds++;
+}
+
+void GLStateCache::DrawElements(GLenum mode, GLsizei count, size_t indexOffset) {
+    glDrawElements(mode, count, GL_UNSIGNED_INT, (void*)(indexOffset * sizeof(GLuint)));
+    stats.drawCalls++;
+    if (mode == GL_TRIANGLES) stats.triangles += count / 3;
+}
+
+void GLStateCache::DrawArrays(GLenum mode, GLint first, GLsizei count) {
+    glDrawArrays(mode, first, count);
+    stats.drawCalls++;
+    if (mode == GL_TRIANGLES) stats.triangles += count / 3;
+    if (mode == GL_POINTS) stats.points += count;
+}
+
+void GLStateCache::Invalidate() {
+    currentProgram = -1;
+    currentVertexArray = -1;
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstddef>
+
+//remembers what is bound so repeated binds of the same program or VAO never reach the driver
+//also counts the work it submits, call Invalidate after code that binds things directly
+class GLStateCache {
+public:
+    struct Stats {
+        unsigned int drawCalls = 0;
+        unsigned int triangles = 0;
+        unsigned int points = 0;
+        unsigned int programBinds = 0;
+        unsigned int vertexArrayBinds = 0;
+        unsigned int skippedBinds = 0;
+    };
+
+    void UseProgram(GLuint program);
+    void BindVertexArray(GLuint vertexArray);
+    void DrawElements(GLenum mode, GLsizei count, size_t indexOffset);
+    void DrawArrays(GLenum mode, GLint first, GLsizei count);
+
+    //forget what is bound, the next bind always goes through
+    void Invalidate();
+
+    //adds draws made outside the cache to the stats
+    void CountDraw(unsigned int triangles, unsigned int points = 0) {
+        stats.drawCalls++;
+        stats.triangles += triangles;
+        stats.points += points;
+    }
+
+    void ResetStats() { stats = Stats(); }
+    const Stats& GetStats() const { return stats; }
+
+private:
+    //-1 means unknown
+    long long currentProgram = -1;
+    long long currentVertexArray = -1;
+    Stats stats;
+};
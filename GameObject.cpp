@@ -1,7 +1,24 @@
 #include "GameObject.h"
 #define TINYOBJLOADER_IMPLEMENTATION
 #include "tiny_obj_loader.h"
+#include "MeshSimplifier.h"
+#include "RenderQueue.h"
+#include "Camera/MyCamera.h"
 #include <iostream>
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace {
+    //fraction of triangles kept and smallest on screen radius (pixels) for each level
+    const float lodRatios[GameObject::MaxLods] = { 1.0f, 0.4f, 0.15f, 0.05f };
+    const float lodMinScreenRadius[GameObject::MaxLods] = { 32.0f, 12.0f, 5.0f, 0.0f };
+
+    //simplifying is expensive so every path is only parsed and reduced once
+    std::mutex modelCacheMutex;
+    std::map<std::string, std::shared_ptr<const GameObject::MeshData>> modelCache;
+}
 
 //GameObject::GameObject(const std::string& modelPath, Shader& shader)
 //    : shader(shader) {
@@ -15,7 +32,13 @@ GameObject::~GameObject() {
     glDeleteBuffers(1, &EBO);
 }
 
-void GameObject::LoadModel(const std::string& path) {
+std::shared_ptr<const GameObject::MeshData> GameObject::LoadMeshData(const std::string& path) {
+    {
+        std::lock_guard<std::mutex> lock(modelCacheMutex);
+        auto found = modelCache.find(path);
+        if (found != modelCache.end()) return found->second;
+    }
+
     tinyobj::attrib_t attributes;
     std::vector<tinyobj::shape_t> shapes;
     std::vector<tinyobj::material_t> materials;
@@ -25,13 +48,34 @@ void GameObject::LoadModel(const std::string& path) {
         throw std::runtime_error(warn + err);
     }
 
-    vertices = attributes.vertices;
-
+    std::vector<GLuint> fullIndices;
     for (const auto& shape : shapes) {
         for (const auto& index : shape.mesh.indices) {
-            indices.push_back(index.vertex_index);
+            fullIndices.push_back(index.vertex_index);
         }
     }
+
+    auto built = std::make_shared<MeshData>();
+    built->vertices = attributes.vertices;
+    built->lodIndices = MeshSimplifier::BuildLodChain(built->vertices, fullIndices,
+        std::vector<float>(lodRatios, lodRatios + MaxLods));
+
+    //if two threads raced on the same path the first one in wins
+    std::lock_guard<std::mutex> lock(modelCacheMutex);
+    return modelCache.emplace(path, built).first->second;
+}
+
+void GameObject::LoadModel(const MeshData& mesh) {
+    vertices = mesh.vertices;
+
+    //pack every level into one index buffer
+    indices.clear();
+    lods.clear();
+    for (size_t i = 0; i < mesh.lodIndices.size(); i++) {
+        const std::vector<GLuint>& level = mesh.lodIndices[i];
+        lods.push_back({ indices.size(), static_cast<GLsizei>(level.size()), lodMinScreenRadius[i] });
+        indices.insert(indices.end(), level.begin(), level.end());
+    }
 }
 
 void GameObject::SetupBuffers() {
@@ -53,21 +97,92 @@ void GameObject::SetupBuffers() {
     glBindVertexArray(0);
 }
 
-void GameObject::Render(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix) const {
+glm::mat4 GameObject::ModelMatrix() const {
     glm::mat4 model = glm::mat4(1.0f);
     model = glm::translate(model, position);
     model = glm::rotate(model, glm::radians(rotationAngle), rotationAxis);
     model = glm::scale(model, scale);
+    return model;
+}
+
+Physics::MeshCollider GameObject::CreateCollider() const {
+    const glm::mat4 model = ModelMatrix();
+    std::vector<float> worldVertices(vertices.size());
+    for (size_t i = 0; i + 2 < vertices.size(); i += 3) {
+        glm::vec4 p = model * glm::vec4(vertices[i], vertices[i + 1], vertices[i + 2], 1.0f);
+        worldVertices[i] = p.x;
+        worldVertices[i + 1] = p.y;
+        worldVertices[i + 2] = p.z;
+    }
+    //level 0 is the front of the shared index buffer
+    std::vector<unsigned int> fullIndices(indices.begin(), indices.begin() + lods[0].indexCount);
+    return Physics::MeshCollider(worldVertices, fullIndices);
+}
+
+void GameObject::Render(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix) const {
+    Render(viewMatrix, projectionMatrix, 0);
+}
+
+void GameObject::Render(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix, int lod) const {
+    if (lods.empty()) return; //nothing to draw
+    glm::mat4 model = ModelMatrix();
 
-    shader.Use();
-    shader.SetMat4("mvp", projectionMatrix * viewMatrix * model);
-    shader.SetVec3("color", color);
+    shader->Use();
+    shader->SetMat4("mvp", projectionMatrix * viewMatrix * model);
+    shader->SetVec3("color", color);
+    shader->SetFloat("alpha", alpha);
 
+    const LodLevel& level = lods[lod];
     glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, level.indexCount, GL_UNSIGNED_INT, (void*)(level.indexOffset * sizeof(GLuint)));
     glBindVertexArray(0);
 }
 
+void GameObject::Submit(RenderQueue& queue, const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix, int lod) const {
+    SubmitWith(queue, viewMatrix, projectionMatrix * viewMatrix, lod);
+}
+
+void GameObject::Submit(RenderQueue& queue, const MyCamera& camera, int lod) const {
+    SubmitWith(queue, camera.GetViewMatrix(), camera.GetViewProjection(), lod);
+}
+
+void GameObject::SubmitWith(RenderQueue& queue, const glm::mat4& viewMatrix, const glm::mat4& viewProjection, int lod) const {
+    if (lods.empty()) return; //nothing to draw
+    glm::mat4 model = ModelMatrix();
+
+    //distance in front of the camera for front to back ordering
+    float depth = -(viewMatrix * glm::vec4(position, 1.0f)).z;
+
+    const LodLevel& level = lods[lod];
+    RenderQueue::DrawItem item;
+    //each level of each mesh gets its own id so same level draws end up next to each other
+    item.key = RenderQueue::MakeKey(shader->ID, VAO * MaxLods + lod, 0, depth);
+    item.shader = shader;
+    item.vertexArray = VAO;
+    item.indexCount = level.indexCount;
+    item.indexOffset = level.indexOffset;
+    item.mvp = viewProjection * model;
+    item.color = color;
+    item.alpha = alpha;
+    queue.Submit(item);
+}
+
+int GameObject::SelectLod(float screenRadius) const {
+    //moved from or empty model, 0 keeps the caller's index valid and the draw skips it
+    if (lods.empty()) return 0;
+    for (size_t i = 0; i < lods.size(); i++) {
+        if (screenRadius >= lods[i].minScreenRadius) return static_cast<int>(i);
+    }
+    return static_cast<int>(lods.size()) - 1;
+}
+
+float GameObject::ProjectedRadius(const glm::mat4& viewProjection, float pixelScale, const glm::vec3& center, float radius) {
+    //clip space w, distance along the view axis for perspective and 1 for ortho
+    float w = viewProjection[0][3] * center.x + viewProjection[1][3] * center.y +
+        viewProjection[2][3] * center.z + viewProjection[3][3];
+    return radius * pixelScale / std::max(std::abs(w), 0.0001f);
+}
+
 //void GameObject::SetPosition(const glm::vec3& position) {
 //    this->position = position;
 //}
@@ -98,11 +213,20 @@ void GameObject::SetRotation(float angle, const glm::vec3& axis) {
 }
 
 GameObject::GameObject(const std::string& modelPath, Shader& shader, const glm::vec3& color)
-    : shader(shader), color(color) {
-    LoadModel(modelPath);
+    : GameObject(*LoadMeshData(modelPath), shader, color) {
+}
+
+GameObject::GameObject(const MeshData& mesh, Shader& shader, const glm::vec3& color)
+    : shader(&shader), color(color) {
+    LoadModel(mesh);
     SetupBuffers();
 }
 
 void GameObject::SetColor(const glm::vec3& newColor) {
     color = newColor;
+}
+
+void GameObject::SetColor(const glm::vec4& newColor) {
+    color = glm::vec3(newColor);
+    alpha = newColor.a;
 }
\ No newline at end of file
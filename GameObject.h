@@ -3,25 +3,69 @@
 #include <glm/glm.hpp>
 #include <vector>
 #include <string>
+#include <memory>
 #include "Shader.h"
 #include "p6/MyVector.h"
+#include "p6/MeshCollider.h"
+
+class RenderQueue;
+class MyCamera;
 
 class GameObject {
 public:
+    //parsed model with its LOD chain, everything needed before touching GL
+    struct MeshData {
+        std::vector<GLfloat> vertices;
+        std::vector<std::vector<GLuint>> lodIndices;
+    };
+
+    //parses and simplifies a model, no GL calls so it is safe on any thread
+    //results are cached by path so each model is only processed once
+    static std::shared_ptr<const MeshData> LoadMeshData(const std::string& modelPath);
+
     //GameObject(const std::string& modelPath, Shader& shader);
     ~GameObject();
 
+    //number of detail levels generated for every loaded model
+    static const int MaxLods = 4;
+
     void Render(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix) const;
+    //draws one of the simplified levels, 0 is the full mesh
+    void Render(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix, int lod) const;
+
+    //queues the draw instead of issuing it, the queue sorts and batches state changes
+    void Submit(RenderQueue& queue, const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix, int lod = 0) const;
+    //same but reuses the camera's cached view projection instead of multiplying it per object
+    void Submit(RenderQueue& queue, const MyCamera& camera, int lod = 0) const;
+
+    //picks the level for a sphere covering screenRadius pixels
+    int SelectLod(float screenRadius) const;
+    int GetLodCount() const { return static_cast<int>(lods.size()); }
+    GLsizei GetIndexCount(int lod) const { return lods[lod].indexCount; }
+
+    //static collider from the full detail mesh placed where the object is now
+    //moving the object afterwards does not move the collider
+    Physics::MeshCollider CreateCollider() const;
+
+    //radius in pixels of a projected sphere, pixelScale is projection[1][1] * viewportHeight / 2
+    static float ProjectedRadius(const glm::mat4& viewProjection, float pixelScale, const glm::vec3& center, float radius);
 
     //void SetPosition(const glm::vec3& position);
     //void SetScale(const glm::vec3& scale);
     GameObject(const std::string& modelPath, Shader& shader, const glm::vec3& color = glm::vec3(1.0f));
+    //GL thread only, builds the buffers from an already parsed model
+    GameObject(const MeshData& mesh, Shader& shader, const glm::vec3& color = glm::vec3(1.0f));
     void SetRotation(float angle, const glm::vec3& axis);
     void SetPosition(const Physics::MyVector& position);
     void SetScale(const Physics::MyVector& scale);
     Physics::MyVector GetPosition() const;
     Physics::MyVector GetScale() const;
     void SetColor(const glm::vec3& newColor);
+    //rgb plus alpha, alpha below 1 only shows when blending is enabled
+    void SetColor(const glm::vec4& newColor);
+    void SetAlpha(float newAlpha) { alpha = newAlpha; }
+    glm::vec3 GetColor() const { return color; }
+    float GetAlpha() const { return alpha; }
 
 
     //pashe one
@@ -33,7 +77,9 @@ public:
         color(std::move(other.color)),
         VAO(other.VAO), VBO(other.VBO), EBO(other.EBO),
         vertices(std::move(other.vertices)),
-        indices(std::move(other.indices)) {
+        indices(std::move(other.indices)),
+        lods(std::move(other.lods)),
+        alpha(other.alpha) {
         other.VAO = other.VBO = other.EBO = 0;  // Invalidate source
     }
 
@@ -50,11 +96,13 @@ public:
             position = std::move(other.position);
             scale = std::move(other.scale);
             color = std::move(other.color);
+            alpha = other.alpha;
             VAO = other.VAO;
             VBO = other.VBO;
             EBO = other.EBO;
             vertices = std::move(other.vertices);
             indices = std::move(other.indices);
+            lods = std::move(other.lods);
 
             // Invalidate source
             other.VAO = other.VBO = other.EBO = 0;
@@ -67,13 +115,24 @@ public:
     GameObject& operator=(const GameObject&) = delete;
 
 private:
-    void LoadModel(const std::string& modelPath);
+    //range of the shared index buffer used by one level
+    struct LodLevel {
+        size_t indexOffset;
+        GLsizei indexCount;
+        float minScreenRadius;
+    };
+
+    void LoadModel(const MeshData& mesh);
+    glm::mat4 ModelMatrix() const;
     void SetupBuffers();
+    void SubmitWith(RenderQueue& queue, const glm::mat4& viewMatrix, const glm::mat4& viewProjection, int lod) const;
 
     GLuint VAO, VBO, EBO;
-    Shader& shader;
+    Shader* shader; //pointer so move assignment can rebind it
     std::vector<GLfloat> vertices;
+    //every level back to back, level 0 first
     std::vector<GLuint> indices;
+    std::vector<LodLevel> lods;
 
     glm::vec3 position = glm::vec3(0.0f);
     glm::vec3 scale = glm::vec3(1.0f);
@@ -81,4 +140,5 @@ private:
     float rotationAngle = 0.0f;
 
     glm::vec3 color;
+    float alpha = 1.0f;
 };
\ No newline at end of file
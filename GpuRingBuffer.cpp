@@ -0,0 +1,120 @@
+#include "GpuRingBuffer.h"
+#include <cstring>
+
+GpuRingBuffer::GpuRingBuffer(GLenum target, size_t bytesPerFrame)
+    : target(target) {
+    //needs GL 4.4 or ARB_buffer_storage for persistent mapping
+    persistent = GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage;
+    Create(bytesPerFrame);
+}
+
+GpuRingBuffer::~GpuRingBuffer() {
+    Destroy();
+}
+
+void GpuRingBuffer::Create(size_t bytesPerFrame) {
+    regionSize = bytesPerFrame;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(target, buffer);
+
+    if (persistent) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(target, regionSize * FramesInFlight, nullptr, flags);
+        mapped = static_cast<char*>(glMapBufferRange(target, 0, regionSize * FramesInFlight, flags));
+        if (!mapped) {
+            //driver said yes but would not map it, use the fallback instead
+            glBindBuffer(target, 0);
+            glDeleteBuffers(1, &buffer);
+            persistent = false;
+            Create(bytesPerFrame);
+            return;
+        }
+    }
+    else {
+        glBufferData(target, regionSize, nullptr, GL_STREAM_DRAW);
+        staging.resize(regionSize);
+    }
+
+    glBindBuffer(target, 0);
+}
+
+void GpuRingBuffer::Destroy() {
+    for (int i = 0; i < FramesInFlight; i++) {
+        WaitForRegion(i);
+    }
+    if (mapped) {
+        glBindBuffer(target, buffer);
+        glUnmapBuffer(target);
+        glBindBuffer(target, 0);
+        mapped = nullptr;
+    }
+    glDeleteBuffers(1, &buffer);
+    buffer = 0;
+}
+
+void GpuRingBuffer::WaitForRegion(int region) {
+    GLsync& fence = fences[region];
+    if (!fence) return;
+
+    //flush on the first wait so the fence is guaranteed to signal
+    GLbitfield waitFlags = GL_SYNC_FLUSH_COMMANDS_BIT;
+    while (true) {
+        GLenum result = glClientWaitSync(fence, waitFlags, 1000000); //1ms
+        if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED || result == GL_WAIT_FAILED) break;
+        waitFlags = 0;
+    }
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
+void GpuRingBuffer::BeginFrame(size_t bytesNeeded) {
+    if (bytesNeeded > regionSize) {
+        //grow geometrically so a slowly rising particle count does not recreate every frame
+        size_t newSize = regionSize * 2;
+        if (newSize < bytesNeeded) newSize = bytesNeeded;
+        Destroy();
+        Create(newSize);
+    }
+
+    head = 0;
+    committed = 0;
+
+    if (persistent) {
+        WaitForRegion(frame);
+    }
+    else {
+        //orphan, the driver hands back fresh storage while the old one is still being read
+        glBindBuffer(target, buffer);
+        glBufferData(target, regionSize, nullptr, GL_STREAM_DRAW);
+        glBindBuffer(target, 0);
+    }
+}
+
+GpuRingBuffer::Allocation GpuRingBuffer::Allocate(size_t size, size_t alignment) {
+    size_t start = (head + alignment - 1) / alignment * alignment;
+    if (start + size > regionSize) return { nullptr, 0 };
+    head = start + size;
+
+    if (persistent) {
+        size_t base = static_cast<size_t>(frame) * regionSize;
+        return { mapped + base + start, static_cast<GLintptr>(base + start) };
+    }
+    return { staging.data() + start, static_cast<GLintptr>(start) };
+}
+
+void GpuRingBuffer::Commit() {
+    //coherent mapping needs nothing, writes are already visible
+    if (!persistent && head > committed) {
+        glBindBuffer(target, buffer);
+        glBufferSubData(target, committed, head - committed, staging.data() + committed);
+        glBindBuffer(target, 0);
+    }
+    committed = head;
+}
+
+void GpuRingBuffer::EndFrame() {
+    if (persistent) {
+        fences[frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        frame = (frame + 1) % FramesInFlight;
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <glad/glad.h>
+#include <vector>
+#include <cstddef>
+
+//streams per frame data (sprites, instance data) to the GPU without stalling
+//uses a persistent coherent mapping split into one region per frame in flight, each guarded by a fence,
+//so the CPU fills frame N+1 while the GPU still reads frame N
+//when buffer storage is not available it falls back to orphaning + glBufferSubData
+class GpuRingBuffer {
+public:
+    //frames the CPU may run ahead of the GPU
+    static const int FramesInFlight = 3;
+
+    struct Allocation {
+        void* data;      //write the data here, nullptr if the region is full
+        GLintptr offset; //byte offset into GetBuffer() to bind or draw from
+    };
+
+    GpuRingBuffer(GLenum target, size_t bytesPerFrame);
+    ~GpuRingBuffer();
+
+    GpuRingBuffer(const GpuRingBuffer&) = delete;
+    GpuRingBuffer& operator=(const GpuRingBuffer&) = delete;
+
+    //waits until the GPU is done with the next region, growing it first if bytesNeeded will not fit
+    void BeginFrame(size_t bytesNeeded = 0);
+    Allocation Allocate(size_t size, size_t alignment = 16);
+    //makes everything allocated so far visible to the GPU, call before drawing from it
+    void Commit();
+    //fences the region so it is not reused until the GPU has drawn from it
+    void EndFrame();
+
+    GLuint GetBuffer() const { return buffer; }
+    bool IsPersistent() const { return persistent; }
+
+private:
+    void Create(size_t bytesPerFrame);
+    void Destroy();
+    void WaitForRegion(int region);
+
+    GLenum target;
+    GLuint buffer = 0;
+    bool persistent = false;
+    size_t regionSize = 0;
+
+    int frame = 0;
+    size_t head = 0;
+    size_t committed = 0;
+
+    //persistent path
+    char* mapped = nullptr;
+    GLsync fences[FramesInFlight] = {};
+
+    //fallback path
+    std::vector<char> staging;
+};
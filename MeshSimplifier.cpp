@@ -0,0 +1,227 @@
+#include "MeshSimplifier.h"
+#include <glm/glm.hpp>
+#include <queue>
+#include <map>
+#include <algorithm>
+
+namespace {
+    //symmetric 4x4 matrix stored as its upper triangle
+    struct Quadric {
+        double q[10] = { 0 };
+
+        void AddPlane(double a, double b, double c, double d, double weight) {
+            q[0] += weight * a * a; q[1] += weight * a * b; q[2] += weight * a * c; q[3] += weight * a * d;
+            q[4] += weight * b * b; q[5] += weight * b * c; q[6] += weight * b * d;
+            q[7] += weight * c * c; q[8] += weight * c * d;
+            q[9] += weight * d * d;
+        }
+
+        void operator+=(const Quadric& rhs) {
+            for (int i = 0; i < 10; i++) q[i] += rhs.q[i];
+        }
+
+        //squared distance of the point to every plane summed into this quadric
+        double Evaluate(const glm::vec3& p) const {
+            double x = p.x, y = p.y, z = p.z;
+            return q[0] * x * x + 2 * q[1] * x * y + 2 * q[2] * x * z + 2 * q[3] * x
+                + q[4] * y * y + 2 * q[5] * y * z + 2 * q[6] * y
+                + q[7] * z * z + 2 * q[8] * z
+                + q[9];
+        }
+    };
+
+    struct Collapse {
+        double cost;
+        unsigned int from, to;
+        unsigned int fromStamp, toStamp;
+
+        bool operator>(const Collapse& rhs) const { return cost > rhs.cost; }
+    };
+
+    class Simplifier {
+    public:
+        Simplifier(const std::vector<float>& vertices, const std::vector<unsigned int>& indices)
+            : tris(indices) {
+            size_t vertexCount = vertices.size() / 3;
+            size_t triCount = indices.size() / 3;
+
+            positions.resize(vertexCount);
+            for (size_t i = 0; i < vertexCount; i++) {
+                positions[i] = glm::vec3(vertices[i * 3], vertices[i * 3 + 1], vertices[i * 3 + 2]);
+            }
+
+            quadrics.resize(vertexCount);
+            vertTris.resize(vertexCount);
+            stamps.assign(vertexCount, 0);
+            triAlive.assign(triCount, 1);
+            liveTris = triCount;
+
+            //face planes, area weighted so tiny slivers do not dominate
+            std::map<std::pair<unsigned int, unsigned int>, int> edgeUse;
+            for (size_t t = 0; t < triCount; t++) {
+                unsigned int* v = &tris[t * 3];
+                glm::vec3 n = glm::cross(positions[v[1]] - positions[v[0]], positions[v[2]] - positions[v[0]]);
+                float area = glm::length(n);
+                if (area > 0.0f) n /= area;
+                double d = -glm::dot(n, positions[v[0]]);
+                for (int k = 0; k < 3; k++) {
+                    quadrics[v[k]].AddPlane(n.x, n.y, n.z, d, area * 0.5);
+                    vertTris[v[k]].push_back(static_cast<unsigned int>(t));
+
+                    unsigned int a = v[k], b = v[(k + 1) % 3];
+                    edgeUse[std::make_pair(std::min(a, b), std::max(a, b))]++;
+                }
+            }
+
+            //open edges get a stiff plane perpendicular to their face so borders do not shrink
+            for (size_t t = 0; t < triCount; t++) {
+                unsigned int* v = &tris[t * 3];
+                glm::vec3 n = glm::cross(positions[v[1]] - positions[v[0]], positions[v[2]] - positions[v[0]]);
+                if (glm::length(n) <= 0.0f) continue;
+                n = glm::normalize(n);
+                for (int k = 0; k < 3; k++) {
+                    unsigned int a = v[k], b = v[(k + 1) % 3];
+                    if (edgeUse[std::make_pair(std::min(a, b), std::max(a, b))] != 1) continue;
+
+                    glm::vec3 edge = positions[b] - positions[a];
+                    float length = glm::length(edge);
+                    if (length <= 0.0f) continue;
+                    glm::vec3 side = glm::normalize(glm::cross(edge, n));
+                    double d = -glm::dot(side, positions[a]);
+                    const double boundaryWeight = 1000.0 * length * length;
+                    quadrics[a].AddPlane(side.x, side.y, side.z, d, boundaryWeight);
+                    quadrics[b].AddPlane(side.x, side.y, side.z, d, boundaryWeight);
+                }
+            }
+
+            for (size_t t = 0; t < triCount; t++) {
+                unsigned int* v = &tris[t * 3];
+                for (int k = 0; k < 3; k++) {
+                    PushCollapse(v[k], v[(k + 1) % 3]);
+                    PushCollapse(v[(k + 1) % 3], v[k]);
+                }
+            }
+        }
+
+        //collapses until at most target triangles are alive or nothing legal is left
+        void Reduce(size_t target) {
+            while (liveTris > target && !heap.empty()) {
+                Collapse c = heap.top();
+                heap.pop();
+
+                //stale entry, one of the endpoints changed since it was pushed
+                if (c.fromStamp != stamps[c.from] || c.toStamp != stamps[c.to]) continue;
+                if (!CollapseKeepsOrientation(c.from, c.to)) continue;
+
+                DoCollapse(c.from, c.to);
+            }
+        }
+
+        std::vector<unsigned int> LiveIndices() const {
+            std::vector<unsigned int> out;
+            out.reserve(liveTris * 3);
+            for (size_t t = 0; t < triAlive.size(); t++) {
+                if (!triAlive[t]) continue;
+                out.push_back(tris[t * 3]);
+                out.push_back(tris[t * 3 + 1]);
+                out.push_back(tris[t * 3 + 2]);
+            }
+            return out;
+        }
+
+        size_t TriangleCount() const { return triAlive.size(); }
+
+    private:
+        std::vector<glm::vec3> positions;
+        std::vector<unsigned int> tris;
+        std::vector<char> triAlive;
+        std::vector<Quadric> quadrics;
+        std::vector<std::vector<unsigned int>> vertTris;
+        std::vector<unsigned int> stamps;
+        std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> heap;
+        size_t liveTris = 0;
+
+        void PushCollapse(unsigned int from, unsigned int to) {
+            Quadric q = quadrics[from];
+            q += quadrics[to];
+            heap.push({ q.Evaluate(positions[to]), from, to, stamps[from], stamps[to] });
+        }
+
+        //rejects collapses that would fold a surviving triangle over
+        bool CollapseKeepsOrientation(unsigned int from, unsigned int to) const {
+            for (unsigned int t : vertTris[from]) {
+                if (!triAlive[t]) continue;
+                const unsigned int* v = &tris[t * 3];
+                if (v[0] == to || v[1] == to || v[2] == to) continue; //this one disappears
+
+                glm::vec3 before[3], after[3];
+                for (int k = 0; k < 3; k++) {
+                    before[k] = positions[v[k]];
+                    after[k] = v[k] == from ? positions[to] : positions[v[k]];
+                }
+                glm::vec3 n0 = glm::cross(before[1] - before[0], before[2] - before[0]);
+                glm::vec3 n1 = glm::cross(after[1] - after[0], after[2] - after[0]);
+                if (glm::dot(n0, n1) <= 0.0f) return false;
+            }
+            return true;
+        }
+
+        void DoCollapse(unsigned int from, unsigned int to) {
+            for (unsigned int t : vertTris[from]) {
+                if (!triAlive[t]) continue;
+                unsigned int* v = &tris[t * 3];
+                if (v[0] == to || v[1] == to || v[2] == to) {
+                    triAlive[t] = 0;
+                    liveTris--;
+                    continue;
+                }
+                for (int k = 0; k < 3; k++) {
+                    if (v[k] == from) v[k] = to;
+                }
+                vertTris[to].push_back(t);
+            }
+            vertTris[from].clear();
+
+            quadrics[to] += quadrics[from];
+            //from is gone for good, to changed so all its old entries go stale
+            stamps[from]++;
+            stamps[to]++;
+
+            for (unsigned int t : vertTris[to]) {
+                if (!triAlive[t]) continue;
+                const unsigned int* v = &tris[t * 3];
+                for (int k = 0; k < 3; k++) {
+                    if (v[k] == to) continue;
+                    PushCollapse(to, v[k]);
+                    PushCollapse(v[k], to);
+                }
+            }
+        }
+    };
+}
+
+std::vector<std::vector<unsigned int>> MeshSimplifier::BuildLodChain(
+    const std::vector<float>& vertices,
+    const std::vector<unsigned int>& indices,
+    const std::vector<float>& ratios) {
+    std::vector<std::vector<unsigned int>> chain;
+    Simplifier simplifier(vertices, indices);
+
+    //tiny meshes like cubes and planes have nothing worth removing
+    const size_t minTriangles = std::min<size_t>(simplifier.TriangleCount(), 16);
+
+    //one pass down to the smallest level, grabbing the index list at every target on the way
+    for (float ratio : ratios) {
+        size_t target = static_cast<size_t>(ratio * simplifier.TriangleCount());
+        simplifier.Reduce(std::max(target, minTriangles));
+        chain.push_back(simplifier.LiveIndices());
+    }
+    return chain;
+}
+
+std::vector<unsigned int> MeshSimplifier::Simplify(
+    const std::vector<float>& vertices,
+    const std::vector<unsigned int>& indices,
+    float ratio) {
+    return BuildLodChain(vertices, indices, { ratio }).front();
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <vector>
+
+//quadric error metric simplifier (Garland & Heckbert) used to build LOD chains at import
+//collapses always move a vertex onto one of its neighbours so every level can share
+//the original vertex buffer and only the index lists differ
+class MeshSimplifier {
+public:
+    //vertices are packed xyz, indices are triangles
+    //returns one index list per ratio, ratios are fractions of the original triangle count
+    //and should be in descending order, 1.0 gives back the original mesh
+    static std::vector<std::vector<unsigned int>> BuildLodChain(
+        const std::vector<float>& vertices,
+        const std::vector<unsigned int>& indices,
+        const std::vector<float>& ratios);
+
+    //single level helper
+    static std::vector<unsigned int> Simplify(
+        const std::vector<float>& vertices,
+        const std::vector<unsigned int>& indices,
+        float ratio);
+};
@@ -0,0 +1,389 @@
+#include "RenderBenchmark.h"
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "GameObject.h"
+#include "Shader.h"
+#include "SpriteBatch.h"
+#include "RenderQueue.h"
+#include "GLStateCache.h"
+#include "Camera/Frustum.h"
+#include "DepthSorter.h"
+#include "WeightedBlendedOit.h"
+
+namespace {
+    struct Options {
+        int particles = 10000;
+        int frames = 300;
+        int warmupFrames = 10;
+        int width = 800;
+        int height = 800;
+        int contextApi = GLFW_NATIVE_CONTEXT_API;
+    };
+
+    Options ParseOptions(int argc, char** argv) {
+        Options options;
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg == "--particles" && i + 1 < argc) options.particles = std::atoi(argv[++i]);
+            else if (arg == "--frames" && i + 1 < argc) options.frames = std::atoi(argv[++i]);
+            else if (arg == "--size" && i + 2 < argc) {
+                options.width = std::atoi(argv[++i]);
+                options.height = std::atoi(argv[++i]);
+            }
+            else if (arg == "--egl") options.contextApi = GLFW_EGL_CONTEXT_API;
+            else if (arg == "--osmesa") options.contextApi = GLFW_OSMESA_CONTEXT_API;
+        }
+        options.particles = std::max(options.particles, 0);
+        options.frames = std::max(options.frames, 1);
+        return options;
+    }
+
+    //fixed seed so every run draws the same scene
+    struct Scene {
+        std::vector<float> x, y, z, scale;
+        std::vector<glm::vec3> color;
+
+        explicit Scene(int count) {
+            std::mt19937 gen(1234);
+            std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+            std::uniform_real_distribution<float> size(0.5f, 5.0f);
+            std::uniform_real_distribution<float> hue(0.0f, 1.0f);
+            for (int i = 0; i < count; i++) {
+                x.push_back(position(gen));
+                y.push_back(position(gen));
+                z.push_back(position(gen));
+                scale.push_back(size(gen));
+                color.push_back(glm::vec3(hue(gen), hue(gen), hue(gen)));
+            }
+        }
+
+        size_t Size() const { return x.size(); }
+    };
+
+    //color + depth renderbuffers plus a ring of pixel pack buffers for async readback
+    class OffscreenTarget {
+    public:
+        static const int ReadbackSlots = 3;
+
+        OffscreenTarget(int width, int height) : width(width), height(height) {
+            glGenFramebuffers(1, &fbo);
+            glGenRenderbuffers(1, &colorBuffer);
+            glGenRenderbuffers(1, &depthBuffer);
+
+            glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+            glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+            glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+            glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+            glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+            glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+            complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+            glGenBuffers(ReadbackSlots, pbos);
+            for (int i = 0; i < ReadbackSlots; i++) {
+                glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[i]);
+                glBufferData(GL_PIXEL_PACK_BUFFER, width * height * 4, nullptr, GL_STREAM_READ);
+            }
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        }
+
+        ~OffscreenTarget() {
+            for (int i = 0; i < ReadbackSlots; i++) {
+                if (fences[i]) glDeleteSync(fences[i]);
+            }
+            glDeleteBuffers(ReadbackSlots, pbos);
+            glDeleteRenderbuffers(1, &colorBuffer);
+            glDeleteRenderbuffers(1, &depthBuffer);
+            glDeleteFramebuffers(1, &fbo);
+        }
+
+        bool IsComplete() const { return complete; }
+
+        void Bind() const {
+            glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+            glViewport(0, 0, width, height);
+        }
+
+        //starts the copy of this frame into a PBO and finishes the oldest one still in flight
+        void Readback() {
+            int slot = frame % ReadbackSlots;
+
+            //slot is about to be reused, collect the frame it holds first
+            if (fences[slot]) Collect(slot);
+
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[slot]);
+            glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+            fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            frame++;
+        }
+
+        //collects every frame still in flight
+        void Drain() {
+            for (int i = 0; i < ReadbackSlots; i++) {
+                int slot = (frame + i) % ReadbackSlots;
+                if (fences[slot]) Collect(slot);
+            }
+        }
+
+        //sum of the center pixel over every collected frame, printed so the readback cannot be optimized away
+        unsigned long long GetChecksum() const { return checksum; }
+
+    private:
+        void Collect(int slot) {
+            glClientWaitSync(fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+            glDeleteSync(fences[slot]);
+            fences[slot] = nullptr;
+
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[slot]);
+            const unsigned char* pixels = static_cast<const unsigned char*>(
+                glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, width * height * 4, GL_MAP_READ_BIT));
+            if (pixels) {
+                size_t center = (static_cast<size_t>(height / 2) * width + width / 2) * 4;
+                checksum += pixels[center] + pixels[center + 1] + pixels[center + 2];
+                glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            }
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        }
+
+        int width, height;
+        GLuint fbo = 0, colorBuffer = 0, depthBuffer = 0;
+        GLuint pbos[ReadbackSlots] = {};
+        GLsync fences[ReadbackSlots] = {};
+        int frame = 0;
+        bool complete = false;
+        unsigned long long checksum = 0;
+    };
+
+    struct PathResult {
+        std::string name;
+        std::vector<double> frameMs;
+        GLStateCache::Stats totals;
+        unsigned long long checksum;
+    };
+
+    typedef std::function<void(const glm::mat4& view, const glm::mat4& projection, GLStateCache& state)> DrawPath;
+
+    PathResult RunPath(const std::string& name, const DrawPath& draw, const Options& options) {
+        using clock = std::chrono::steady_clock;
+        OffscreenTarget target(options.width, options.height);
+        GLStateCache state;
+        PathResult result;
+        result.name = name;
+
+        glm::mat4 projection = glm::perspective(glm::radians(45.0f),
+            static_cast<float>(options.width) / options.height, 0.1f, 500.0f);
+
+        for (int frame = 0; frame < options.warmupFrames + options.frames; frame++) {
+            bool measured = frame >= options.warmupFrames;
+            if (frame == options.warmupFrames) state.ResetStats();
+
+            //same orbit as the interactive camera
+            float angle = frame * 0.01f;
+            glm::mat4 view = glm::lookAt(glm::vec3(sin(angle) * 180.0f, 40.0f, cos(angle) * 180.0f),
+                glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+            auto start = clock::now();
+            target.Bind();
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            draw(view, projection, state);
+            target.Readback();
+            auto end = clock::now();
+
+            if (measured) result.frameMs.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+        }
+
+        target.Drain();
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        result.totals = state.GetStats();
+        result.checksum = target.GetChecksum();
+        return result;
+    }
+
+    void PrintResult(const PathResult& result) {
+        std::vector<double> sorted = result.frameMs;
+        std::sort(sorted.begin(), sorted.end());
+        double total = 0;
+        for (double ms : sorted) total += ms;
+        double frames = static_cast<double>(sorted.size());
+
+        std::printf("%-10s %8.3f %8.3f %8.3f %8.3f %12.0f %12.0f %12.0f %10llu\n",
+            result.name.c_str(),
+            total / frames,
+            sorted[sorted.size() / 2],
+            sorted[std::min(sorted.size() - 1, static_cast<size_t>(frames * 0.95))],
+            sorted.back(),
+            result.totals.drawCalls / frames,
+            result.totals.triangles / frames,
+            result.totals.points / frames,
+            result.checksum);
+    }
+}
+
+int RenderBenchmark::Run(int argc, char** argv) {
+    Options options = ParseOptions(argc, argv);
+
+    if (!glfwInit()) {
+        std::printf("ERROR::BENCH::GLFW_INIT_FAILED\n");
+        return 1;
+    }
+
+    //never shown, everything goes into the FBO
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_CONTEXT_CREATION_API, options.contextApi);
+    GLFWwindow* window = glfwCreateWindow(options.width, options.height, "YN-GINE bench", NULL, NULL);
+    if (!window) {
+        std::printf("ERROR::BENCH::CONTEXT_CREATION_FAILED (try --egl or --osmesa)\n");
+        glfwTerminate();
+        return 1;
+    }
+    glfwMakeContextCurrent(window);
+    glfwSwapInterval(0);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+        glfwTerminate();
+        return 1;
+    }
+
+    std::printf("renderer: %s | %s\n", glGetString(GL_RENDERER), glGetString(GL_VERSION));
+    std::printf("particles: %d  frames: %d  size: %dx%d\n\n", options.particles, options.frames, options.width, options.height);
+
+    int result = 0;
+    {
+        std::vector<std::unique_ptr<Shader>> programs = Shader::CompileBatch({
+            { "Shaders/sample.vert", "Shaders/sample.frag" },
+            { "Shaders/sprite.vert", "Shaders/sprite.frag" },
+            { "Shaders/sprite.vert", "Shaders/sprite_oit.frag" },
+            { "Shaders/oit_composite.vert", "Shaders/oit_composite.frag" },
+        });
+        GameObject sphere("3D/sphere.obj", *programs[0]);
+        SpriteBatch sprites(*programs[1]);
+        RenderQueue queue;
+        Scene scene(options.particles);
+        std::vector<uint32_t> visible;
+        DepthSorter sorter(Physics::ThreadPool::Shared());
+        Physics::FrameArena frameArena;
+        WeightedBlendedOit oit(*programs[3]);
+
+        glEnable(GL_DEPTH_TEST);
+        glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+
+        OffscreenTarget probe(options.width, options.height);
+        if (!probe.IsComplete()) {
+            std::printf("ERROR::BENCH::FRAMEBUFFER_INCOMPLETE\n");
+            result = 1;
+        }
+        else {
+            std::vector<PathResult> results;
+
+            //what the main loop used to do, one full detail draw per particle
+            results.push_back(RunPath("direct", [&](const glm::mat4& view, const glm::mat4& projection, GLStateCache& state) {
+                for (size_t i = 0; i < scene.Size(); i++) {
+                    sphere.SetPosition(Physics::MyVector(scene.x[i], scene.y[i], scene.z[i]));
+                    sphere.SetScale(Physics::MyVector(scene.scale[i], scene.scale[i], scene.scale[i]));
+                    sphere.SetColor(scene.color[i]);
+                    sphere.Render(view, projection);
+                    state.CountDraw(sphere.GetIndexCount(0) / 3);
+                }
+            }, options));
+
+            //frustum culled, LOD selected, sorted and state cached
+            results.push_back(RunPath("queued", [&](const glm::mat4& view, const glm::mat4& projection, GLStateCache& state) {
+                Frustum frustum(projection * view);
+                frustum.CullSpheres(scene.x.data(), scene.y.data(), scene.z.data(), scene.scale.data(), scene.Size(), visible);
+
+                glm::mat4 viewProjection = projection * view;
+                float pixelScale = projection[1][1] * options.height * 0.5f;
+                queue.Clear();
+                for (uint32_t i : visible) {
+                    glm::vec3 center(scene.x[i], scene.y[i], scene.z[i]);
+                    sphere.SetPosition(Physics::MyVector(center.x, center.y, center.z));
+                    sphere.SetScale(Physics::MyVector(scene.scale[i], scene.scale[i], scene.scale[i]));
+                    sphere.SetColor(scene.color[i]);
+                    sphere.Submit(queue, view, projection,
+                        sphere.SelectLod(GameObject::ProjectedRadius(viewProjection, pixelScale, center, scene.scale[i])));
+                }
+                queue.Sort();
+                queue.Execute(state);
+            }, options));
+
+            //culled point sprites in one draw
+            results.push_back(RunPath("sprites", [&](const glm::mat4& view, const glm::mat4& projection, GLStateCache& state) {
+                Frustum frustum(projection * view);
+                frustum.CullSpheres(scene.x.data(), scene.y.data(), scene.z.data(), scene.scale.data(), scene.Size(), visible);
+
+                sprites.Clear();
+                for (uint32_t i : visible) {
+                    sprites.Add(glm::vec3(scene.x[i], scene.y[i], scene.z[i]), scene.scale[i], scene.color[i]);
+                }
+                sprites.Draw(view, projection, static_cast<float>(options.height));
+                state.CountDraw(0, static_cast<unsigned int>(visible.size()));
+            }, options));
+
+            //half transparent sprites sorted back to front every frame
+            results.push_back(RunPath("blended", [&](const glm::mat4& view, const glm::mat4& projection, GLStateCache& state) {
+                frameArena.Reset();
+                Frustum frustum(projection * view);
+                frustum.CullSpheres(scene.x.data(), scene.y.data(), scene.z.data(), scene.scale.data(), scene.Size(), visible);
+                sorter.SortBackToFront(scene.x.data(), scene.y.data(), scene.z.data(), visible, view, frameArena);
+
+                sprites.Clear();
+                for (uint32_t i : visible) {
+                    sprites.Add(glm::vec3(scene.x[i], scene.y[i], scene.z[i]), scene.scale[i], glm::vec4(scene.color[i], 0.5f));
+                }
+                glEnable(GL_BLEND);
+                glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+                glDepthMask(GL_FALSE);
+                sprites.Draw(view, projection, static_cast<float>(options.height));
+                glDepthMask(GL_TRUE);
+                glDisable(GL_BLEND);
+                state.CountDraw(0, static_cast<unsigned int>(visible.size()));
+            }, options));
+
+            //same sprites unsorted through weighted blended transparency, when the context can do it
+            if (WeightedBlendedOit::IsSupported()) {
+                results.push_back(RunPath("oit", [&](const glm::mat4& view, const glm::mat4& projection, GLStateCache& state) {
+                    Frustum frustum(projection * view);
+                    frustum.CullSpheres(scene.x.data(), scene.y.data(), scene.z.data(), scene.scale.data(), scene.Size(), visible);
+
+                    sprites.Clear();
+                    for (uint32_t i : visible) {
+                        sprites.Add(glm::vec3(scene.x[i], scene.y[i], scene.z[i]), scene.scale[i], glm::vec4(scene.color[i], 0.5f));
+                    }
+                    oit.Begin(options.width, options.height);
+                    sprites.Draw(view, projection, static_cast<float>(options.height), programs[2].get());
+                    oit.End();
+                    state.CountDraw(1, static_cast<unsigned int>(visible.size()));
+                }, options));
+            }
+
+            std::printf("%-10s %8s %8s %8s %8s %12s %12s %12s %10s\n",
+                "path", "avg ms", "p50 ms", "p95 ms", "max ms", "draws/frame", "tris/frame", "points/frame", "checksum");
+            for (const PathResult& path : results) {
+                PrintResult(path);
+            }
+
+            //the sort scratch should settle into a single block after the first frames
+            Physics::FrameArena::Stats arenaStats = frameArena.GetStats();
+            std::printf("frame arena: high water %zu KB, capacity %zu KB in %zu block(s)\n",
+                arenaStats.highWater / 1024, arenaStats.capacity / 1024, arenaStats.blocks);
+        }
+    }
+
+    glfwTerminate();
+    return result;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+//offscreen render benchmark, started with GDPHYSX-SampleProject --bench [options]
+//renders N particles into an FBO through each render path (direct GameObject draws,
+//culled + sorted RenderQueue, point sprites), reads every frame back through a ring of
+//PBOs so readback never stalls the pipeline, and prints frame times and draw/triangle counts
+//
+//options:
+//  --particles N     particles drawn per frame (default 10000)
+//  --frames N        measured frames per path (default 300)
+//  --size W H        framebuffer size (default 800 800)
+//  --egl / --osmesa  context creation API for machines without a display (default native, hidden window)
+class RenderBenchmark {
+public:
+    static int Run(int argc, char** argv);
+};
@@ -0,0 +1,69 @@
+#include "RenderQueue.h"
+#include "p6/RadixSort.h"
+#include <glm/gtc/type_ptr.hpp>
+
+uint64_t RenderQueue::MakeKey(uint32_t shaderId, uint32_t meshId, uint32_t materialId, float depth) {
+    //negative depth is behind the camera, it all lands in the first bucket
+    uint32_t depthBits = depth > 0.0f ? (Physics::FloatToSortableBits(depth) >> 8) : 0;
+
+    return (static_cast<uint64_t>(shaderId & 0xFFF) << 52) |
+        (static_cast<uint64_t>(meshId & 0xFFFF) << 36) |
+        (static_cast<uint64_t>(materialId & 0xFFF) << 24) |
+        static_cast<uint64_t>(depthBits & 0xFFFFFF);
+}
+
+void RenderQueue::Clear() {
+    items.clear();
+}
+
+void RenderQueue::Submit(const DrawItem& item) {
+    items.push_back(item);
+}
+
+void RenderQueue::Sort() {
+    keys.resize(items.size());
+    order.resize(items.size());
+    for (size_t i = 0; i < items.size(); i++) {
+        keys[i] = items[i].key;
+        order[i] = static_cast<uint32_t>(i);
+    }
+    Physics::RadixSortPairs(keys, order, keyScratch, orderScratch);
+}
+
+void RenderQueue::UseSubmitOrder() {
+    order.resize(items.size());
+    for (size_t i = 0; i < items.size(); i++) {
+        order[i] = static_cast<uint32_t>(i);
+    }
+}
+
+void RenderQueue::Execute(GLStateCache& state) {
+    //whatever ran before may have bound things behind the cache's back
+    state.Invalidate();
+
+    const Shader* boundShader = nullptr;
+    GLint mvpLocation = -1;
+    GLint colorLocation = -1;
+    GLint alphaLocation = -1;
+
+    for (uint32_t index : order) {
+        const DrawItem& item = items[index];
+
+        //uniform locations only have to be looked up when the program changes
+        if (item.shader != boundShader) {
+            boundShader = item.shader;
+            state.UseProgram(boundShader->ID);
+            mvpLocation = glGetUniformLocation(boundShader->ID, "mvp");
+            colorLocation = glGetUniformLocation(boundShader->ID, "color");
+            alphaLocation = glGetUniformLocation(boundShader->ID, "alpha");
+        }
+        state.BindVertexArray(item.vertexArray);
+
+        glUniformMatrix4fv(mvpLocation, 1, GL_FALSE, glm::value_ptr(item.mvp));
+        glUniform3fv(colorLocation, 1, glm::value_ptr(item.color));
+        glUniform1f(alphaLocation, item.alpha);
+        state.DrawElements(GL_TRIANGLES, item.indexCount, item.indexOffset);
+    }
+
+    state.BindVertexArray(0);
+}
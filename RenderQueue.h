@@ -0,0 +1,48 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+#include "Shader.h"
+#include "GLStateCache.h"
+
+//collects draws for a frame, sorts them by a 64 bit key and submits them with as few
+//program and VAO changes as possible
+//key layout from the top bit down: shader 12 | mesh 16 | material 12 | depth 24
+class RenderQueue {
+public:
+    struct DrawItem {
+        uint64_t key;
+        const Shader* shader;
+        GLuint vertexArray;
+        GLsizei indexCount;
+        size_t indexOffset;
+        glm::mat4 mvp;
+        glm::vec3 color;
+        float alpha;
+    };
+
+    //depth is the view space distance, sorted front to back so early z rejects more
+    static uint64_t MakeKey(uint32_t shaderId, uint32_t meshId, uint32_t materialId, float depth);
+
+    void Clear();
+    void Submit(const DrawItem& item);
+    //radix sorts the submitted items by key
+    void Sort();
+    //draws in the order things were submitted instead, for callers that already ordered them
+    //like blended particles sorted back to front, where a key sort would break the order
+    void UseSubmitOrder();
+    //draws everything in sorted order through the state cache
+    void Execute(GLStateCache& state);
+
+    size_t Size() const { return items.size(); }
+
+private:
+    std::vector<DrawItem> items;
+
+    //sort buffers kept between frames
+    std::vector<uint64_t> keys;
+    std::vector<uint32_t> order;
+    std::vector<uint64_t> keyScratch;
+    std::vector<uint32_t> orderScratch;
+};
@@ -1,6 +1,62 @@
 #include "Shader.h"
+#include <cstdint>
+#include <cstdio>
+
+namespace {
+    bool ProgramBinariesSupported() {
+        if (!GLAD_GL_VERSION_4_1 && !GLAD_GL_ARB_get_program_binary) return false;
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        return formats > 0;
+    }
+
+    //FNV-1a, only has to tell sources apart
+    uint64_t HashString(const std::string& text, uint64_t hash = 14695981039346656037ull) {
+        for (unsigned char c : text) {
+            hash ^= c;
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    std::string GetString(GLenum name) {
+        const GLubyte* value = glGetString(name);
+        return value ? reinterpret_cast<const char*>(value) : "";
+    }
+}
+
+Shader::Shader() : ID(0) {}
+
+Shader::Shader(const char* vertexPath, const char* fragmentPath) : ID(0) {
+    BeginBuild(vertexPath, fragmentPath);
+    FinishBuild();
+}
+
+Shader::~Shader() {
+    glDeleteProgram(ID);
+}
+
+std::vector<std::unique_ptr<Shader>> Shader::CompileBatch(const std::vector<std::pair<std::string, std::string>>& paths) {
+    //let the driver spread compiles over as many threads as it likes
+    if (GLAD_GL_KHR_parallel_shader_compile) {
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+    }
+    else if (GLAD_GL_ARB_parallel_shader_compile) {
+        glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+    }
 
-Shader::Shader(const char* vertexPath, const char* fragmentPath) {
+    std::vector<std::unique_ptr<Shader>> programs;
+    for (const auto& path : paths) {
+        programs.emplace_back(new Shader());
+        programs.back()->BeginBuild(path.first.c_str(), path.second.c_str());
+    }
+    for (auto& program : programs) {
+        program->FinishBuild();
+    }
+    return programs;
+}
+
+void Shader::BeginBuild(const char* vertexPath, const char* fragmentPath) {
     // 1. Retrieve shader source code
     std::string vertexCode, fragmentCode;
     std::ifstream vShaderFile, fShaderFile;
@@ -26,45 +82,111 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath) {
         std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
     }
 
+    ID = glCreateProgram();
+
+    // 2. Try the binary from a previous launch, keyed on both sources and the driver
+    if (ProgramBinariesSupported()) {
+        uint64_t hash = HashString(vertexCode);
+        hash = HashString(std::string(1, '\0') + fragmentCode, hash);
+        hash = HashString(GetString(GL_VENDOR) + GetString(GL_RENDERER) + GetString(GL_VERSION), hash);
+
+        char name[64];
+        std::snprintf(name, sizeof(name), "Shaders/program_%016llx.bin", static_cast<unsigned long long>(hash));
+        cachePath = name;
+
+        if (LoadCachedBinary()) return;
+
+        //stale or rejected binary, compile from source and overwrite it
+        glProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
     const char* vShaderCode = vertexCode.c_str();
     const char* fShaderCode = fragmentCode.c_str();
 
-    // 2. Compile shaders
-    GLuint vertex, fragment;
-
-    // Vertex shader
-    vertex = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex, 1, &vShaderCode, NULL);
-    glCompileShader(vertex);
-    CheckCompileErrors(vertex, "VERTEX");
+    // 3. Compile shaders, results are only checked in FinishBuild
+    pendingVertex = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(pendingVertex, 1, &vShaderCode, NULL);
+    glCompileShader(pendingVertex);
 
-    // Fragment shader
-    fragment = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment, 1, &fShaderCode, NULL);
-    glCompileShader(fragment);
-    CheckCompileErrors(fragment, "FRAGMENT");
+    pendingFragment = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(pendingFragment, 1, &fShaderCode, NULL);
+    glCompileShader(pendingFragment);
 
     // Shader program
-    ID = glCreateProgram();
-    glAttachShader(ID, vertex);
-    glAttachShader(ID, fragment);
+    glAttachShader(ID, pendingVertex);
+    glAttachShader(ID, pendingFragment);
     glLinkProgram(ID);
+}
+
+void Shader::FinishBuild() {
+    //loaded from the cache, nothing was compiled
+    if (!pendingVertex && !pendingFragment) return;
+
+    CheckCompileErrors(pendingVertex, "VERTEX");
+    CheckCompileErrors(pendingFragment, "FRAGMENT");
     CheckCompileErrors(ID, "PROGRAM");
 
-    glDeleteShader(vertex);
-    glDeleteShader(fragment);
+    glDetachShader(ID, pendingVertex);
+    glDetachShader(ID, pendingFragment);
+    glDeleteShader(pendingVertex);
+    glDeleteShader(pendingFragment);
+    pendingVertex = pendingFragment = 0;
+
+    GLint linked = GL_FALSE;
+    glGetProgramiv(ID, GL_LINK_STATUS, &linked);
+    if (linked && !cachePath.empty()) SaveCachedBinary();
+}
+
+bool Shader::LoadCachedBinary() {
+    std::ifstream file(cachePath, std::ios::binary);
+    if (!file) return false;
+
+    GLenum format = 0;
+    file.read(reinterpret_cast<char*>(&format), sizeof(format));
+    if (file.gcount() != sizeof(format)) return false;
+    std::vector<char> binary((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (binary.empty()) return false;
+
+    //the driver refuses binaries it no longer understands, that just means compiling again
+    glProgramBinary(ID, format, binary.data(), static_cast<GLsizei>(binary.size()));
+    GLint linked = GL_FALSE;
+    glGetProgramiv(ID, GL_LINK_STATUS, &linked);
+    return linked == GL_TRUE;
+}
+
+void Shader::SaveCachedBinary() const {
+    GLint length = 0;
+    glGetProgramiv(ID, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(ID, length, NULL, &format, binary.data());
+
+    std::ofstream file(cachePath, std::ios::binary | std::ios::trunc);
+    if (!file) return;
+    file.write(reinterpret_cast<const char*>(&format), sizeof(format));
+    file.write(binary.data(), binary.size());
 }
 
 void Shader::Use() const {
     glUseProgram(ID);
 }
 
-void Shader::SetMat4(const std::string& name, const glm::mat4& mat) const {
-    glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, glm::value_ptr(mat));
+void Shader::SetMat4(const char* name, const glm::mat4& mat) const {
+    glUniformMatrix4fv(glGetUniformLocation(ID, name), 1, GL_FALSE, glm::value_ptr(mat));
 }
 
-void Shader::SetVec3(const std::string& name, const glm::vec3& value) const {
-    glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, glm::value_ptr(value));
+void Shader::SetVec3(const char* name, const glm::vec3& value) const {
+    glUniform3fv(glGetUniformLocation(ID, name), 1, glm::value_ptr(value));
+}
+
+void Shader::SetFloat(const char* name, float value) const {
+    glUniform1f(glGetUniformLocation(ID, name), value);
+}
+
+void Shader::SetInt(const char* name, int value) const {
+    glUniform1i(glGetUniformLocation(ID, name), value);
 }
 
 void Shader::CheckCompileErrors(GLuint shader, const std::string& type) const {
@@ -84,4 +206,4 @@ void Shader::CheckCompileErrors(GLuint shader, const std::string& type) const {
             std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << std::endl;
         }
     }
-}
\ No newline at end of file
+}
@@ -4,6 +4,9 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
+#include <memory>
+#include <utility>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
@@ -12,10 +15,38 @@ public:
     GLuint ID;
 
     Shader(const char* vertexPath, const char* fragmentPath);
+    ~Shader();
+
+    Shader(const Shader&) = delete;
+    Shader& operator=(const Shader&) = delete;
+
+    //builds several programs at once, every compile and link is issued before any result is
+    //queried so drivers with parallel shader compile can work on them side by side
+    //paths are (vertex, fragment) pairs, programs come back in the same order
+    static std::vector<std::unique_ptr<Shader>> CompileBatch(const std::vector<std::pair<std::string, std::string>>& paths);
+
     void Use() const;
-    void SetMat4(const std::string& name, const glm::mat4& mat) const;
-    void SetVec3(const std::string& name, const glm::vec3& value) const;
+    //plain C string names so passing a literal does not build a std::string every call
+    void SetMat4(const char* name, const glm::mat4& mat) const;
+    void SetVec3(const char* name, const glm::vec3& value) const;
+    void SetFloat(const char* name, float value) const;
+    void SetInt(const char* name, int value) const;
 
 private:
+    Shader();
+
+    //reads the sources and either loads a cached binary or starts compiling without waiting
+    void BeginBuild(const char* vertexPath, const char* fragmentPath);
+    //waits for the link, reports errors and stores the binary for next launch
+    void FinishBuild();
+
+    //linked programs are cached on disk keyed by the source and driver so startup skips compiling
+    bool LoadCachedBinary();
+    void SaveCachedBinary() const;
+
     void CheckCompileErrors(GLuint shader, const std::string& type) const;
-};
\ No newline at end of file
+
+    std::string cachePath;
+    GLuint pendingVertex = 0;
+    GLuint pendingFragment = 0;
+};
@@ -0,0 +1,15 @@
+#version 330 core
+
+in vec2 texCoord;
+
+out vec4 FragColor; // Returns a color
+uniform sampler2D floorTexture;
+uniform int useTexture; //0 while the texture is still loading
+uniform vec3 color;
+
+//Tiles the floor texture, flat color until it is ready
+void main()
+{
+	vec3 albedo = useTexture != 0 ? texture(floorTexture, texCoord).rgb * color : color;
+	FragColor = vec4(albedo, 1.0);
+}
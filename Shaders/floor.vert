@@ -0,0 +1,17 @@
+#version 330 core
+
+uniform mat4 viewProjection;
+uniform float height; //y of the floor plane
+uniform float halfSize; //the square spans -halfSize to halfSize on x and z
+uniform float tileSize; //world units covered by one repeat of the texture
+
+out vec2 texCoord;
+
+//one square drawn as a 4 vertex strip, corners come from the vertex id so no vertex buffer is needed
+void main()
+{
+	vec2 corner = vec2(gl_VertexID & 1, (gl_VertexID >> 1) & 1) * 2.0 - 1.0;
+	vec3 position = vec3(corner.x * halfSize, height, corner.y * halfSize);
+	texCoord = position.xz / tileSize;
+	gl_Position = viewProjection * vec4(position, 1.0);
+}
@@ -0,0 +1,20 @@
+#version 330 core
+
+uniform sampler2D accumulation;
+uniform sampler2D revealage;
+
+out vec4 FragColor; // Returns a color
+
+//Resolves the weighted sums into one color, blended over the opaque scene
+void main()
+{
+	ivec2 pixel = ivec2(gl_FragCoord.xy);
+	float reveal = texelFetch(revealage, pixel, 0).r;
+	if (reveal >= 1.0) discard; //nothing transparent here
+
+	vec4 accum = texelFetch(accumulation, pixel, 0);
+	vec3 average = accum.rgb / max(accum.a, 1e-5);
+
+	//alpha is what shows through, End blends the background by it
+	FragColor = vec4(average, reveal);
+}
@@ -2,10 +2,11 @@
 
 out vec4 FragColor; // Returns a color
 uniform vec3 color;
+uniform float alpha = 1.0; //only visible with blending on
 
 //Simple shader that colors the model 
 void main()
 {
 	//				  R   G   B  a  Ranges from 0->1
-	FragColor = vec4(color, 1.0); //Sets the color of the fragment
+	FragColor = vec4(color, alpha); //Sets the color of the fragment
 }
\ No newline at end of file
@@ -0,0 +1,20 @@
+#version 330 core
+
+in vec4 spriteColor;
+
+out vec4 FragColor; // Returns a color
+
+//Shades the point sprite as if it were a sphere
+void main()
+{
+	//-1 -> 1 across the sprite
+	vec2 coord = gl_PointCoord * 2.0 - 1.0;
+	float r2 = dot(coord, coord);
+	if (r2 > 1.0) discard; //outside the circle
+
+	//normal of the sphere under this pixel
+	vec3 normal = vec3(coord.x, -coord.y, sqrt(1.0 - r2));
+	float light = 0.3 + 0.7 * max(dot(normal, normalize(vec3(0.4, 0.6, 0.7))), 0.0);
+
+	FragColor = vec4(spriteColor.rgb * light, spriteColor.a);
+}
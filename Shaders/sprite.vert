@@ -0,0 +1,20 @@
+#version 330 core
+
+layout(location = 0) in vec3 aPos;
+layout(location = 1) in float aSize;
+layout(location = 2) in vec4 aColor;
+
+uniform mat4 viewProjection;
+
+//projection[1][1] * viewport height / 2, turns a world radius into pixels
+uniform float pointScale;
+
+out vec4 spriteColor;
+
+void main()
+{
+	gl_Position = viewProjection * vec4(aPos, 1.0);
+	//diameter in pixels, w is 1 for ortho and the view depth for perspective
+	gl_PointSize = 2.0 * aSize * pointScale / gl_Position.w;
+	spriteColor = aColor;
+}
@@ -0,0 +1,26 @@
+#version 330 core
+
+in vec4 spriteColor;
+
+//weighted blended transparency, both targets are summed so draw order does not matter
+layout(location = 0) out vec4 Accumulation; //premultiplied color and alpha, weighted
+layout(location = 1) out float Revealage; //product of (1 - alpha), written through the blend factor
+
+//Same sphere shading as sprite.frag
+void main()
+{
+	vec2 coord = gl_PointCoord * 2.0 - 1.0;
+	float r2 = dot(coord, coord);
+	if (r2 > 1.0) discard; //outside the circle
+
+	vec3 normal = vec3(coord.x, -coord.y, sqrt(1.0 - r2));
+	float light = 0.3 + 0.7 * max(dot(normal, normalize(vec3(0.4, 0.6, 0.7))), 0.0);
+
+	vec4 color = vec4(spriteColor.rgb * light, spriteColor.a);
+
+	//nearer fragments weigh more (McGuire and Bavoil 2013, depth based weight)
+	float weight = clamp(color.a * max(1e-2, 3e3 * pow(1.0 - gl_FragCoord.z, 3.0)), 1e-2, 3e3);
+
+	Accumulation = vec4(color.rgb * color.a, color.a) * weight;
+	Revealage = color.a;
+}
@@ -0,0 +1,77 @@
+#include "SpriteBatch.h"
+#include <cstddef>
+#include <cstring>
+
+namespace {
+    //room for this many sprites per frame before the ring buffer has to grow
+    const size_t initialSprites = 16384;
+}
+
+SpriteBatch::SpriteBatch(Shader& shader)
+    : shader(shader), VAO(0), stream(GL_ARRAY_BUFFER, initialSprites * sizeof(SpriteVertex)) {
+    SetupBuffers();
+}
+
+SpriteBatch::~SpriteBatch() {
+    glDeleteVertexArrays(1, &VAO);
+}
+
+void SpriteBatch::SetupBuffers() {
+    glGenVertexArrays(1, &VAO);
+
+    glBindVertexArray(VAO);
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glEnableVertexAttribArray(2);
+    glBindVertexArray(0);
+}
+
+void SpriteBatch::BindAttributes(GLintptr offset) {
+    glBindBuffer(GL_ARRAY_BUFFER, stream.GetBuffer());
+
+    //position, size, color interleaved
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(SpriteVertex), (void*)(offset + offsetof(SpriteVertex, position)));
+    glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, sizeof(SpriteVertex), (void*)(offset + offsetof(SpriteVertex, size)));
+    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteVertex), (void*)(offset + offsetof(SpriteVertex, color)));
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void SpriteBatch::Clear() {
+    sprites.clear();
+}
+
+void SpriteBatch::Add(const glm::vec3& position, float size, const glm::vec3& color) {
+    sprites.push_back({ position, size, glm::vec4(color, 1.0f) });
+}
+
+void SpriteBatch::Add(const glm::vec3& position, float size, const glm::vec4& color) {
+    sprites.push_back({ position, size, color });
+}
+
+void SpriteBatch::Draw(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix, float viewportHeight,
+    Shader* shaderOverride) {
+    if (sprites.empty()) return;
+
+    //write straight into the slice the GPU is not reading
+    size_t bytes = sprites.size() * sizeof(SpriteVertex);
+    stream.BeginFrame(bytes);
+    GpuRingBuffer::Allocation slice = stream.Allocate(bytes, sizeof(float));
+    std::memcpy(slice.data, sprites.data(), bytes);
+    stream.Commit();
+
+    //lets the vertex shader size each point
+    glEnable(GL_PROGRAM_POINT_SIZE);
+
+    Shader& program = shaderOverride ? *shaderOverride : shader;
+    program.Use();
+    program.SetMat4("viewProjection", projectionMatrix * viewMatrix);
+    program.SetFloat("pointScale", projectionMatrix[1][1] * viewportHeight * 0.5f);
+
+    glBindVertexArray(VAO);
+    BindAttributes(slice.offset);
+    glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(sprites.size()));
+    glBindVertexArray(0);
+
+    stream.EndFrame();
+}
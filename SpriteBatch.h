@@ -0,0 +1,46 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include "Shader.h"
+#include "GpuRingBuffer.h"
+
+//draws many small particles as GL point sprites in a single call
+//only position, size and color are streamed per particle, the sprite shader fakes the sphere
+class SpriteBatch {
+public:
+    SpriteBatch(Shader& shader);
+    ~SpriteBatch();
+
+    SpriteBatch(const SpriteBatch&) = delete;
+    SpriteBatch& operator=(const SpriteBatch&) = delete;
+
+    //starts a new frame of sprites
+    void Clear();
+    //size is the world space radius, same as the scale of the sphere mesh
+    void Add(const glm::vec3& position, float size, const glm::vec3& color);
+    //color alpha only shows when blending is on, sprites are drawn in the order they were added
+    void Add(const glm::vec3& position, float size, const glm::vec4& color);
+    //uploads everything added since Clear and draws it
+    //shaderOverride swaps the fragment stage, e.g. the order independent transparency one
+    void Draw(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix, float viewportHeight,
+        Shader* shaderOverride = nullptr);
+
+    size_t Size() const { return sprites.size(); }
+
+private:
+    struct SpriteVertex {
+        glm::vec3 position;
+        float size;
+        glm::vec4 color;
+    };
+
+    void SetupBuffers();
+    //points the attributes at this frame's slice of the ring buffer
+    void BindAttributes(GLintptr offset);
+
+    Shader& shader;
+    GLuint VAO;
+    GpuRingBuffer stream;
+    std::vector<SpriteVertex> sprites;
+};
@@ -0,0 +1,216 @@
+#include "SteadyStateAudit.h"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "Camera/PerspectiveCamera.h"
+#include "DepthSorter.h"
+#include "p6/AllocationAudit.h"
+#include "p6/FrameArena.h"
+#include "p6/ForceField.h"
+#include "p6/LifetimeWheel.h"
+#include "p6/MeshCollider.h"
+#include "p6/ParticleBoundary.h"
+#include "p6/ObjectPool.h"
+#include "p6/ParticleEmitter.h"
+#include "p6/PhysicsParticle.h"
+#include "p6/PhysicsWorld.h"
+#include "p6/ThreadPool.h"
+
+using namespace Physics;
+
+namespace {
+    struct Options {
+        int particles = 5000;
+        int warmup = 900;
+        int frames = 600;
+    };
+
+    Options ParseOptions(int argc, char** argv) {
+        Options options;
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg == "--particles" && i + 1 < argc) options.particles = std::atoi(argv[++i]);
+            else if (arg == "--warmup" && i + 1 < argc) options.warmup = std::atoi(argv[++i]);
+            else if (arg == "--frames" && i + 1 < argc) options.frames = std::atoi(argv[++i]);
+        }
+        options.particles = std::max(options.particles, 1);
+        options.warmup = std::max(options.warmup, 0);
+        options.frames = std::max(options.frames, 1);
+        return options;
+    }
+
+    struct Particle {
+        PhysicsParticle physics;
+        float birth = 0;
+        float death = 0;
+        glm::vec3 color = glm::vec3(1.0f);
+    };
+
+    //same loop as the demo's simulation thread and render loop, run back to back on one thread
+    class Fountain {
+    public:
+        explicit Fountain(const Options& options)
+            : capacity(static_cast<size_t>(options.particles)),
+            deflector(DeflectorVertices(), { 0, 1, 2, 0, 2, 3 }),
+            floor(ParticleBoundary::Plane(MyVector(0, 1, 0), -90.0f)),
+            walls(ParticleBoundary::Box(MyVector(-100, -100, -100), MyVector(100, 100, 100))),
+            turbulence(16, 16, 16, MyVector(-100, -100, -100), MyVector(100, 100, 100)),
+            forces(GravityForceGenerator(MyVector(0, -9.8f, 0)), &turbulence),
+            emitter(Settings(options.particles), 1234),
+            lifetimes(DeltaTime),
+            camera(45.0f, 0.1f, 500.0f),
+            sorter(ThreadPool::Shared()) {
+            camera.SetViewport(800.0f, 800.0f);
+            camera.setCenter(glm::vec3(0.0f)); //orbits the origin like the demo
+            //rebuilt every few steps so the background builds and swaps are audited too
+            turbulence.Animate([](ForceField::Grid& grid, float time) {
+                ForceField::BuildCurlNoise(grid, 1u, 0.02f, 6.0f, time);
+            }, 0.1f);
+            world.SetForcePipeline(&forces);
+            world.AddCollider(&deflector);
+            //one boundary through contacts and one resolved in place, so both paths are audited
+            walls.SetResolveInPlace(true);
+            world.AddBoundary(&floor);
+            world.AddBoundary(&walls);
+            world.SetContinuousCollision(true);
+            world.AddFluid(&fluid);
+        }
+
+        void Step() {
+            {
+                AllocationScope scope("simulation");
+                emitter.Update(DeltaTime, spawned, capacity - particles.Size());
+                for (size_t i = 0; i < spawned.Size(); i++) {
+                    Particle& p = *particles.Create();
+                    p.physics.Position = spawned.Position(i);
+                    p.physics.mass = 1.0f;
+                    p.physics.Damping = 0.9f;
+                    p.physics.Velocity = spawned.Velocity(i);
+                    p.physics.AddForce(spawned.Force(i));
+                    p.color = spawned.color[i];
+                    p.birth = lifetimes.Now();
+                    p.death = lifetimes.Add(&p, spawned.lifetime[i]);
+                    world.AddParticle(&p.physics);
+                    fluid.AddParticle(&p.physics);
+                }
+
+                world.Update(DeltaTime);
+                turbulence.Update(DeltaTime);
+
+                lifetimes.Advance(DeltaTime, expired);
+                if (!expired.empty()) {
+                    for (Particle* p : expired) world.RemoveParticle(&p->physics);
+                    world.FlushRemovals();
+                    for (Particle* p : expired) particles.Destroy(p);
+                    expired.clear();
+                }
+
+                ParticleSnapshot& snapshot = world.BeginSnapshot();
+                particles.ForEach([&](const Particle& p) {
+                    float lifeRatio = lifetimes.LifeRatio(p.birth, p.death);
+                    snapshot.Push(p.physics.Position, p.physics.mass * lifeRatio, p.color, lifeRatio);
+                });
+                world.PublishSnapshot();
+            }
+
+            {
+                AllocationScope scope("render");
+                frameArena.Reset();
+                world.AcquireSnapshot();
+                const ParticleSnapshot& snapshot = world.GetSnapshot();
+
+                //slow orbit so the camera caches are rebuilt every frame like in the demo
+                orbit += 0.01f;
+                camera.setCameraPosition(glm::vec3(std::sin(orbit) * 200.0f, 40.0f, std::cos(orbit) * 200.0f));
+                camera.GetFrustum().CullSpheres(snapshot.x.data(), snapshot.y.data(), snapshot.z.data(),
+                    snapshot.scale.data(), snapshot.Size(), visible);
+                sorter.SortBackToFront(snapshot.x.data(), snapshot.y.data(), snapshot.z.data(),
+                    visible, camera.GetViewMatrix(), frameArena);
+            }
+        }
+
+        size_t Alive() const { return particles.Size(); }
+        size_t Visible() const { return visible.size(); }
+        const FrameArena& GetFrameArena() const { return frameArena; }
+
+    private:
+        static constexpr float DeltaTime = 1.0f / 60.0f;
+
+        //fountain from the demo, rate set so it spawns faster than particles expire
+        static EmitterSettings Settings(int particles) {
+            EmitterSettings settings;
+            settings.shape = EmitterSettings::Shape::Cone;
+            settings.origin = MyVector(0, -80, 0);
+            settings.axis = MyVector(0, 1, 0);
+            settings.coneAngle = 0.2f;
+            settings.rate = static_cast<float>(particles);
+            settings.force = { 7600.0f, 8400.0f };
+            settings.lifetime = { 1.0f, 3.0f };
+            return settings;
+        }
+
+        //flat plate across the spray so every step has contacts to generate and resolve
+        static std::vector<float> DeflectorVertices() {
+            return { -60, -20, -60, 60, -20, -60, 60, -20, 60, -60, -20, 60 };
+        }
+
+        size_t capacity;
+        MeshCollider deflector;
+        ParticleBoundary floor;
+        ParticleBoundary walls;
+        ForceField turbulence;
+        SphFluid fluid;
+        ForcePipeline<GravityForceGenerator, ForceField*> forces;
+        PhysicsWorld world;
+        ObjectPool<Particle> particles;
+        ParticleEmitter emitter;
+        SpawnBatch spawned;
+        LifetimeWheel<Particle*> lifetimes;
+        std::vector<Particle*> expired;
+
+        PerspectiveCamera camera;
+        float orbit = 0.0f;
+        std::vector<uint32_t> visible;
+        DepthSorter sorter;
+        FrameArena frameArena;
+    };
+
+    constexpr float Fountain::DeltaTime;
+}
+
+int SteadyStateAudit::Run(int argc, char** argv) {
+    if (!AllocationAudit::IsAvailable()) {
+        std::printf("ERROR::AUDIT::NOT_COMPILED_IN rebuild with ALLOC_AUDIT defined\n");
+        return 2;
+    }
+
+    Options options = ParseOptions(argc, argv);
+    Fountain fountain(options);
+
+    for (int i = 0; i < options.warmup; i++) fountain.Step();
+
+    AllocationAudit::BeginWindow();
+    for (int i = 0; i < options.frames; i++) fountain.Step();
+    AllocationAudit::Totals totals = AllocationAudit::EndWindow();
+
+    FrameArena::Stats arenaStats = fountain.GetFrameArena().GetStats();
+    std::printf("steps %d (after %d warmup), %zu particles alive, %zu visible\n",
+        options.frames, options.warmup, fountain.Alive(), fountain.Visible());
+    std::printf("frame arena: high water %zu KB, capacity %zu KB in %zu block(s)\n",
+        arenaStats.highWater / 1024, arenaStats.capacity / 1024, arenaStats.blocks);
+    std::printf("allocations %llu (%llu bytes), frees %llu\n",
+        static_cast<unsigned long long>(totals.allocations), static_cast<unsigned long long>(totals.bytes),
+        static_cast<unsigned long long>(totals.frees));
+
+    if (totals.allocations > 0) {
+        std::printf("ERROR::AUDIT::STEADY_STATE_ALLOCATED\n");
+        AllocationAudit::Report(stdout);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+//headless allocation check, started with GDPHYSX-SampleProject --audit [options]
+//runs the particle fountain into a plate (emitter, world step and contacts, lifetime wheel, snapshot
+//hand off) and the cpu side of a frame (frustum cull, depth sort) until spawns and expiries balance, then counts
+//every heap allocation over a window of steps and fails if there was any
+//needs a build with ALLOC_AUDIT in the preprocessor definitions, otherwise it refuses to run
+//
+//options:
+//  --particles N   live particle cap, the emitter runs faster than this so it stays full (default 5000)
+//  --warmup N      steps before the window, long enough for every buffer to reach its peak (default 900)
+//  --frames N      steps inside the window (default 600)
+//
+//exit code 0 when the window was clean, 1 when it allocated, 2 when auditing is not compiled in
+class SteadyStateAudit {
+public:
+    static int Run(int argc, char** argv);
+};
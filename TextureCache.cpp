@@ -0,0 +1,140 @@
+#include "TextureCache.h"
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+TextureCache::TextureCache(Physics::ThreadPool& pool)
+    : pool(pool) {
+    //GL expects the first row at the bottom
+    stbi_set_flip_vertically_on_load(true);
+}
+
+TextureCache::~TextureCache() {
+    //decodes still in flight hold a pointer to this cache
+    while (decoding.load() > 0) {
+        std::this_thread::yield();
+    }
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    for (auto& entry : cache) {
+        if (entry.second->id) glDeleteTextures(1, &entry.second->id);
+    }
+}
+
+TextureCache::Handle TextureCache::Load(const std::string& path) {
+    Handle texture;
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        auto found = cache.find(path);
+        if (found != cache.end()) return found->second;
+
+        texture = std::make_shared<Texture>();
+        cache.emplace(path, texture);
+    }
+
+    decoding++;
+    pool.Submit([this, path, texture]() { Decode(path, texture); });
+    return texture;
+}
+
+size_t TextureCache::PendingCount() {
+    std::lock_guard<std::mutex> lock(uploadMutex);
+    return decoding.load() + uploads.size();
+}
+
+void TextureCache::Decode(const std::string& path, Handle texture) {
+    int width, height, channels;
+    unsigned char* pixels = stbi_load(path.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+    if (!pixels) {
+        std::cout << "ERROR::TEXTURE::FAILED_TO_LOAD: " << path << " " << stbi_failure_reason() << std::endl;
+        texture->failed = true;
+        decoding--;
+        return;
+    }
+
+    DecodedImage image;
+    image.texture = texture;
+    image.levels.push_back({ width, height, std::vector<unsigned char>(pixels, pixels + width * height * 4) });
+    stbi_image_free(pixels);
+
+    BuildMipChain(image.levels);
+
+    {
+        std::lock_guard<std::mutex> lock(uploadMutex);
+        uploads.push_back(std::move(image));
+    }
+    decoding--;
+}
+
+void TextureCache::BuildMipChain(std::vector<MipLevel>& levels) {
+    while (levels.back().width > 1 || levels.back().height > 1) {
+        const MipLevel& source = levels.back();
+        MipLevel level;
+        level.width = std::max(1, source.width / 2);
+        level.height = std::max(1, source.height / 2);
+        level.pixels.resize(level.width * level.height * 4);
+
+        //2x2 box filter, rows are independent so they are spread over the pool
+        const unsigned char* src = source.pixels.data();
+        unsigned char* dst = level.pixels.data();
+        int srcWidth = source.width, srcHeight = source.height, dstWidth = level.width;
+        pool.ParallelFor(level.height, 64, [=](size_t begin, size_t end) {
+            for (size_t y = begin; y < end; y++) {
+                int y0 = std::min(static_cast<int>(y) * 2, srcHeight - 1);
+                int y1 = std::min(y0 + 1, srcHeight - 1);
+                for (int x = 0; x < dstWidth; x++) {
+                    int x0 = std::min(x * 2, srcWidth - 1);
+                    int x1 = std::min(x0 + 1, srcWidth - 1);
+                    for (int c = 0; c < 4; c++) {
+                        int sum = src[(y0 * srcWidth + x0) * 4 + c] + src[(y0 * srcWidth + x1) * 4 + c] +
+                            src[(y1 * srcWidth + x0) * 4 + c] + src[(y1 * srcWidth + x1) * 4 + c];
+                        dst[(y * dstWidth + x) * 4 + c] = static_cast<unsigned char>((sum + 2) / 4);
+                    }
+                }
+            }
+        });
+
+        levels.push_back(std::move(level));
+    }
+}
+
+void TextureCache::ProcessUploads(float budgetMs) {
+    using clock = std::chrono::steady_clock;
+    auto start = clock::now();
+
+    while (true) {
+        DecodedImage image;
+        {
+            std::lock_guard<std::mutex> lock(uploadMutex);
+            if (uploads.empty()) return;
+            image = std::move(uploads.front());
+            uploads.pop_front();
+        }
+
+        Texture& texture = *image.texture;
+        texture.width = image.levels[0].width;
+        texture.height = image.levels[0].height;
+
+        glGenTextures(1, &texture.id);
+        glBindTexture(GL_TEXTURE_2D, texture.id);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for (size_t i = 0; i < image.levels.size(); i++) {
+            const MipLevel& level = image.levels[i];
+            glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(i), GL_RGBA8, level.width, level.height, 0,
+                GL_RGBA, GL_UNSIGNED_BYTE, level.pixels.data());
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(image.levels.size() - 1));
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        texture.ready = true;
+
+        float elapsedMs = std::chrono::duration<float, std::milli>(clock::now() - start).count();
+        if (elapsedMs >= budgetMs) return;
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <glad/glad.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include "p6/ThreadPool.h"
+
+//loads textures without blocking the frame
+//decoding (stb_image) and mip generation run on the thread pool, the finished levels wait
+//in a queue until the GL thread uploads them, and every path is only loaded once
+class TextureCache {
+public:
+    struct Texture {
+        GLuint id = 0;
+        int width = 0;
+        int height = 0;
+        //set on the GL thread once the texture can be bound
+        std::atomic<bool> ready{ false };
+        std::atomic<bool> failed{ false };
+    };
+    typedef std::shared_ptr<Texture> Handle;
+
+    TextureCache(Physics::ThreadPool& pool);
+    ~TextureCache();
+
+    TextureCache(const TextureCache&) = delete;
+    TextureCache& operator=(const TextureCache&) = delete;
+
+    //returns straight away, check handle->ready before binding
+    Handle Load(const std::string& path);
+
+    //GL thread only, uploads decoded images until budgetMs is spent (at least one per call)
+    void ProcessUploads(float budgetMs = 2.0f);
+
+    //decodes still running or waiting for upload
+    size_t PendingCount();
+
+private:
+    //RGBA8 pixels of one mip level
+    struct MipLevel {
+        int width;
+        int height;
+        std::vector<unsigned char> pixels;
+    };
+    struct DecodedImage {
+        Handle texture;
+        std::vector<MipLevel> levels;
+    };
+
+    void Decode(const std::string& path, Handle texture);
+    void BuildMipChain(std::vector<MipLevel>& levels);
+
+    Physics::ThreadPool& pool;
+
+    std::mutex cacheMutex;
+    std::map<std::string, Handle> cache;
+
+    std::mutex uploadMutex;
+    std::deque<DecodedImage> uploads;
+
+    //decodes queued or running on the pool
+    std::atomic<size_t> decoding{ 0 };
+};
@@ -0,0 +1,131 @@
+#include "WeightedBlendedOit.h"
+#include <iostream>
+
+WeightedBlendedOit::WeightedBlendedOit(Shader& compositeShader)
+    : compositeShader(compositeShader) {
+    glGenVertexArrays(1, &emptyVAO);
+}
+
+WeightedBlendedOit::~WeightedBlendedOit() {
+    glDeleteVertexArrays(1, &emptyVAO);
+    glDeleteTextures(1, &accumulationTexture);
+    glDeleteTextures(1, &revealageTexture);
+    glDeleteRenderbuffers(1, &depthBuffer);
+    glDeleteFramebuffers(1, &fbo);
+}
+
+bool WeightedBlendedOit::IsSupported() {
+    return GLAD_GL_VERSION_4_0 || GLAD_GL_ARB_draw_buffers_blend;
+}
+
+void WeightedBlendedOit::Resize(int newWidth, int newHeight) {
+    width = newWidth;
+    height = newHeight;
+
+    if (!fbo) {
+        glGenFramebuffers(1, &fbo);
+        glGenTextures(1, &accumulationTexture);
+        glGenTextures(1, &revealageTexture);
+        glGenRenderbuffers(1, &depthBuffer);
+    }
+
+    //half floats so thousands of weighted layers do not saturate
+    glBindTexture(GL_TEXTURE_2D, accumulationTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_HALF_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    glBindTexture(GL_TEXTURE_2D, revealageTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, width, height, 0, GL_RED, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    //same format as the usual default framebuffer so the depth blit is allowed
+    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, accumulationTexture, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, revealageTexture, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+    const GLenum targets[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+    glDrawBuffers(2, targets);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cout << "ERROR::OIT::FRAMEBUFFER_INCOMPLETE" << std::endl;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, sceneFramebuffer);
+}
+
+void WeightedBlendedOit::Begin(int viewportWidth, int viewportHeight) {
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &sceneFramebuffer);
+    sceneDepthTest = glIsEnabled(GL_DEPTH_TEST);
+    //minimized windows report 0 x 0, keep the targets valid
+    if (viewportWidth < 1) viewportWidth = 1;
+    if (viewportHeight < 1) viewportHeight = 1;
+    if (viewportWidth != width || viewportHeight != height) Resize(viewportWidth, viewportHeight);
+
+    if (copyDepth) {
+        if (!depthChecked) {
+            while (glGetError() != GL_NO_ERROR) {}
+        }
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, sceneFramebuffer);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbo);
+        glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+        if (!depthChecked) {
+            depthChecked = true;
+            //scene depth has some other format, particles are then only sorted against each other
+            if (glGetError() != GL_NO_ERROR) copyDepth = false;
+        }
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    if (!copyDepth) glClear(GL_DEPTH_BUFFER_BIT);
+
+    const GLfloat zero[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    const GLfloat one[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    glClearBufferfv(GL_COLOR, 0, zero);
+    glClearBufferfv(GL_COLOR, 1, one);
+
+    //tested against the scene but never written, every layer has to reach the targets
+    glDepthMask(GL_FALSE);
+    glEnable(GL_BLEND);
+    if (GLAD_GL_VERSION_4_0) {
+        glBlendFunci(0, GL_ONE, GL_ONE);
+        glBlendFunci(1, GL_ZERO, GL_ONE_MINUS_SRC_COLOR);
+    }
+    else {
+        glBlendFunciARB(0, GL_ONE, GL_ONE);
+        glBlendFunciARB(1, GL_ZERO, GL_ONE_MINUS_SRC_COLOR);
+    }
+}
+
+void WeightedBlendedOit::End() {
+    glBindFramebuffer(GL_FRAMEBUFFER, sceneFramebuffer);
+
+    //average color over whatever is left visible behind the transparent layers
+    glDisable(GL_DEPTH_TEST);
+    glBlendFunc(GL_ONE_MINUS_SRC_ALPHA, GL_SRC_ALPHA);
+
+    compositeShader.Use();
+    compositeShader.SetInt("accumulation", 0);
+    compositeShader.SetInt("revealage", 1);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, accumulationTexture);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, revealageTexture);
+
+    glBindVertexArray(emptyVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glBlendFunc(GL_ONE, GL_ZERO);
+    glDisable(GL_BLEND);
+    glDepthMask(GL_TRUE);
+    if (sceneDepthTest) glEnable(GL_DEPTH_TEST);
+}
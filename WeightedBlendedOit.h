@@ -0,0 +1,47 @@
+#pragma once
+#include <glad/glad.h>
+#include "Shader.h"
+
+//approximate order independent transparency (weighted blended, McGuire and Bavoil 2013)
+//transparent draws add into an accumulation and a revealage target, so they need no sorting,
+//then one full screen pass blends the weighted average over the scene
+//meant for particle clouds too big to sort every frame, overlapping colors are only approximate
+class WeightedBlendedOit {
+public:
+    //compositeShader is oit_composite.vert/.frag, transparent draws need a fragment shader
+    //writing both targets like sprite_oit.frag
+    explicit WeightedBlendedOit(Shader& compositeShader);
+    ~WeightedBlendedOit();
+
+    WeightedBlendedOit(const WeightedBlendedOit&) = delete;
+    WeightedBlendedOit& operator=(const WeightedBlendedOit&) = delete;
+
+    //needs GL 4.0 or ARB_draw_buffers_blend to blend the two targets differently
+    //without either, draw the sorted path instead
+    static bool IsSupported();
+
+    //redirects drawing into the transparency targets, resized to width x height when needed
+    //the scene depth is copied over so opaque geometry still hides what is behind it
+    void Begin(int width, int height);
+    //blends the result over the framebuffer that was bound at Begin and restores the state
+    void End();
+
+private:
+    void Resize(int newWidth, int newHeight);
+
+    Shader& compositeShader;
+    GLuint fbo = 0;
+    GLuint accumulationTexture = 0;
+    GLuint revealageTexture = 0;
+    GLuint depthBuffer = 0;
+    GLuint emptyVAO = 0; //the composite triangle is generated in the vertex shader
+
+    int width = 0;
+    int height = 0;
+    GLint sceneFramebuffer = 0;
+    GLboolean sceneDepthTest = GL_FALSE;
+
+    //depth blits need matching formats, checked on the first frame
+    bool copyDepth = true;
+    bool depthChecked = false;
+};
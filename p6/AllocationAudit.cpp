@@ -0,0 +1,182 @@
+#include "AllocationAudit.h"
+#include <atomic>
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+namespace Physics {
+	namespace {
+		thread_local const char* currentScope = nullptr;
+
+		//one row per (scope, caller) pair, fixed size since the hooks can not allocate
+		struct Site {
+			const char* scope;
+			void* caller;
+			uint64_t count;
+			uint64_t bytes;
+		};
+		const size_t SiteCapacity = 1024;
+		Site sites[SiteCapacity];
+		uint64_t droppedSites = 0; //allocations that found the table full
+		std::atomic_flag sitesLock = ATOMIC_FLAG_INIT;
+
+		std::atomic<bool> recording(false);
+		std::atomic<uint64_t> allocations(0);
+		std::atomic<uint64_t> bytesAllocated(0);
+		std::atomic<uint64_t> frees(0);
+
+		size_t HashSite(const char* scope, void* caller) {
+			uintptr_t key = reinterpret_cast<uintptr_t>(scope) * 31 + reinterpret_cast<uintptr_t>(caller);
+			key ^= key >> 17;
+			key *= 0xed5ad4bbu;
+			key ^= key >> 11;
+			return static_cast<size_t>(key) % SiteCapacity;
+		}
+	}
+
+	bool AllocationAudit::IsAvailable() {
+#ifdef ALLOC_AUDIT
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	void AllocationAudit::BeginWindow() {
+		while (sitesLock.test_and_set(std::memory_order_acquire)) {}
+		for (Site& site : sites) site = Site{ nullptr, nullptr, 0, 0 };
+		droppedSites = 0;
+		sitesLock.clear(std::memory_order_release);
+
+		allocations = 0;
+		bytesAllocated = 0;
+		frees = 0;
+		recording = true;
+	}
+
+	AllocationAudit::Totals AllocationAudit::EndWindow() {
+		recording = false;
+		return Totals{ allocations.load(), bytesAllocated.load(), frees.load() };
+	}
+
+	void AllocationAudit::RecordAllocation(size_t bytes, void* caller) {
+		if (!recording.load(std::memory_order_relaxed)) return;
+		allocations.fetch_add(1, std::memory_order_relaxed);
+		bytesAllocated.fetch_add(bytes, std::memory_order_relaxed);
+
+		const char* scope = currentScope;
+		while (sitesLock.test_and_set(std::memory_order_acquire)) {}
+		//open addressing, a full table just counts the overflow
+		size_t slot = HashSite(scope, caller);
+		for (size_t probe = 0; probe < SiteCapacity; probe++) {
+			Site& site = sites[(slot + probe) % SiteCapacity];
+			if (site.count == 0) {
+				site = Site{ scope, caller, 1, bytes };
+				break;
+			}
+			if (site.scope == scope && site.caller == caller) {
+				site.count++;
+				site.bytes += bytes;
+				break;
+			}
+			if (probe + 1 == SiteCapacity) droppedSites++;
+		}
+		sitesLock.clear(std::memory_order_release);
+	}
+
+	void AllocationAudit::RecordFree() {
+		if (!recording.load(std::memory_order_relaxed)) return;
+		frees.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void AllocationAudit::Report(FILE* out, size_t maxSites) {
+		//sorted copy so the table keeps its hash order
+		Site sorted[SiteCapacity];
+		size_t used = 0;
+		uint64_t dropped;
+		while (sitesLock.test_and_set(std::memory_order_acquire)) {}
+		for (const Site& site : sites) {
+			if (site.count > 0) sorted[used++] = site;
+		}
+		dropped = droppedSites;
+		sitesLock.clear(std::memory_order_release);
+
+		std::sort(sorted, sorted + used, [](const Site& a, const Site& b) { return a.count > b.count; });
+		const size_t shown = std::min(maxSites, used);
+		for (size_t i = 0; i < shown; i++) {
+			std::fprintf(out, "%10llu allocs %12llu bytes  %-24s %p\n",
+				static_cast<unsigned long long>(sorted[i].count), static_cast<unsigned long long>(sorted[i].bytes),
+				sorted[i].scope ? sorted[i].scope : "(no scope)", sorted[i].caller);
+		}
+		if (used > shown) std::fprintf(out, "... %zu more call sites\n", used - shown);
+		if (dropped > 0) {
+			std::fprintf(out, "... %llu allocations not attributed, site table full\n",
+				static_cast<unsigned long long>(dropped));
+		}
+	}
+
+	AllocationScope::AllocationScope(const char* name)
+		: previous(currentScope) {
+		currentScope = name;
+	}
+
+	AllocationScope::~AllocationScope() {
+		currentScope = previous;
+	}
+
+	const char* AllocationScope::Current() {
+		return currentScope;
+	}
+}
+
+#ifdef ALLOC_AUDIT
+//replacements for the global allocation functions, the whole program goes through these
+#if defined(_MSC_VER)
+#include <intrin.h>
+#pragma intrinsic(_ReturnAddress)
+#define AUDIT_CALLER() _ReturnAddress()
+#else
+#define AUDIT_CALLER() __builtin_return_address(0)
+#endif
+
+namespace {
+	void* AuditedAllocate(size_t size, void* caller) {
+		void* memory = std::malloc(size ? size : 1);
+		if (memory) Physics::AllocationAudit::RecordAllocation(size, caller);
+		return memory;
+	}
+
+	void AuditedFree(void* memory) {
+		if (!memory) return;
+		Physics::AllocationAudit::RecordFree();
+		std::free(memory);
+	}
+}
+
+void* operator new(size_t size) {
+	void* memory = AuditedAllocate(size, AUDIT_CALLER());
+	if (!memory) throw std::bad_alloc();
+	return memory;
+}
+
+void* operator new[](size_t size) {
+	void* memory = AuditedAllocate(size, AUDIT_CALLER());
+	if (!memory) throw std::bad_alloc();
+	return memory;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+	return AuditedAllocate(size, AUDIT_CALLER());
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+	return AuditedAllocate(size, AUDIT_CALLER());
+}
+
+void operator delete(void* memory) noexcept { AuditedFree(memory); }
+void operator delete[](void* memory) noexcept { AuditedFree(memory); }
+void operator delete(void* memory, size_t) noexcept { AuditedFree(memory); }
+void operator delete[](void* memory, size_t) noexcept { AuditedFree(memory); }
+void operator delete(void* memory, const std::nothrow_t&) noexcept { AuditedFree(memory); }
+void operator delete[](void* memory, const std::nothrow_t&) noexcept { AuditedFree(memory); }
+#endif
@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+namespace Physics {
+	//counts heap allocations inside a window, used to prove a steady state loop never allocates
+	//the global operator new/delete hooks are only compiled in when ALLOC_AUDIT is defined,
+	//without it IsAvailable is false and the window always comes back empty
+	class AllocationAudit {
+	public:
+		struct Totals {
+			uint64_t allocations;
+			uint64_t bytes;
+			uint64_t frees;
+		};
+
+		static bool IsAvailable();
+
+		//clears the counters and records every allocation on any thread until EndWindow
+		static void BeginWindow();
+		static Totals EndWindow();
+
+		//worst call sites of the last window by count, each is the scope name plus the
+		//address that called operator new, resolve it with the debugger or the map file
+		static void Report(FILE* out, size_t maxSites = 16);
+
+		//called from the hooks, must not allocate
+		static void RecordAllocation(size_t bytes, void* caller);
+		static void RecordFree();
+	};
+
+	//names the subsystem that allocations on this thread belong to while it is alive
+	//scopes nest, the innermost wins, ThreadPool carries the caller's scope over to its helpers
+	class AllocationScope {
+	public:
+		explicit AllocationScope(const char* name);
+		~AllocationScope();
+
+		AllocationScope(const AllocationScope&) = delete;
+		AllocationScope& operator=(const AllocationScope&) = delete;
+
+		//innermost scope on this thread, nullptr outside of any
+		static const char* Current();
+
+	private:
+		const char* previous;
+	};
+}
@@ -0,0 +1,11 @@
+#pragma once
+#include <cstdint>
+
+namespace Physics {
+	//spreads integer grid cells over a hash table, the usual three large primes xor'd together
+	//callers mask the result down to their power of two table size
+	inline uint32_t CellHash(int x, int y, int z) {
+		return (static_cast<uint32_t>(x) * 73856093u) ^ (static_cast<uint32_t>(y) * 19349663u)
+			^ (static_cast<uint32_t>(z) * 83492791u);
+	}
+}
@@ -0,0 +1,288 @@
+#include "ContinuousCollision.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "CellHash.h"
+#include "ThreadPool.h"
+
+namespace Physics {
+	namespace {
+		//fewer swept particles than this are not worth handing to the pool
+		const size_t MinSweepsPerChunk = 256;
+
+		//paths this many times longer than average are kept out of the grid
+		const float OversizedScale = 4.0f;
+
+		struct Bounds {
+			float min[3];
+			float max[3];
+		};
+
+		//grid copy of a path's box
+		struct Entry {
+			Bounds bounds;
+			uint32_t index;
+			uint32_t fast;
+		};
+
+		bool Overlaps(const Bounds& a, const Bounds& b) {
+			return a.min[0] <= b.max[0] && b.min[0] <= a.max[0]
+				&& a.min[1] <= b.max[1] && b.min[1] <= a.max[1]
+				&& a.min[2] <= b.max[2] && b.min[2] <= a.max[2];
+		}
+
+		//where a particle's sweep begins and how many seconds of the step it still has to move
+		struct Path {
+			float x, y, z;
+			float remaining;
+		};
+
+		//earliest time the two spheres touch while both move in straight lines, false if
+		//they miss, already overlap or are moving apart
+		bool TimeOfImpact(const PackedParticles& start, const PackedParticles& end, uint32_t a, uint32_t b, float& time) {
+			//relative start and relative motion, b stays still
+			float px = start.x[a] - start.x[b];
+			float py = start.y[a] - start.y[b];
+			float pz = start.z[a] - start.z[b];
+			float dx = (end.x[a] - start.x[a]) - (end.x[b] - start.x[b]);
+			float dy = (end.y[a] - start.y[a]) - (end.y[b] - start.y[b]);
+			float dz = (end.z[a] - start.z[a]) - (end.z[b] - start.z[b]);
+			float reach = start.radius[a] + start.radius[b];
+
+			float qa = dx * dx + dy * dy + dz * dz;
+			float qb = px * dx + py * dy + pz * dz;
+			float qc = px * px + py * py + pz * pz - reach * reach;
+			if (qc <= 0.0f || qb >= 0.0f || qa <= 0.0f) return false;
+
+			float discriminant = qb * qb - qa * qc;
+			if (discriminant < 0.0f) return false;
+			float t = (-qb - std::sqrt(discriminant)) / qa;
+			if (t < 0.0f || t > 1.0f) return false;
+			time = t;
+			return true;
+		}
+	}
+
+	void ContinuousCollision::FindImpacts(const PackedParticles& start, const PackedParticles& end, const uint8_t* fast,
+		FrameArena& scratch, ArenaVector<Impact>& impacts) const {
+		const size_t count = start.count;
+
+		//box around each particle's whole path this step
+		Bounds* bounds = scratch.AllocateArray<Bounds>(count);
+		float extentSum = 0.0f;
+		for (size_t i = 0; i < count; i++) {
+			const float r = start.radius[i];
+			Bounds& b = bounds[i];
+			b.min[0] = std::min(start.x[i], end.x[i]) - r; b.max[0] = std::max(start.x[i], end.x[i]) + r;
+			b.min[1] = std::min(start.y[i], end.y[i]) - r; b.max[1] = std::max(start.y[i], end.y[i]) + r;
+			b.min[2] = std::min(start.z[i], end.z[i]) - r; b.max[2] = std::max(start.z[i], end.z[i]) + r;
+			extentSum += std::max(b.max[0] - b.min[0], std::max(b.max[1] - b.min[1], b.max[2] - b.min[2]));
+		}
+
+		//paths far longer than average stay out of the grid so they do not blow up the cell size,
+		//the rest go in cells as big as the longest of them, each under the cell its center is in
+		const float oversizedExtent = OversizedScale * std::max(extentSum / count, 1e-3f);
+		uint32_t* oversized = scratch.AllocateArray<uint32_t>(count);
+		size_t oversizedCount = 0;
+		uint8_t* inGrid = scratch.AllocateArray<uint8_t>(count);
+		float cellSize = 1e-3f;
+		for (size_t i = 0; i < count; i++) {
+			const Bounds& b = bounds[i];
+			float extent = std::max(b.max[0] - b.min[0], std::max(b.max[1] - b.min[1], b.max[2] - b.min[2]));
+			inGrid[i] = extent <= oversizedExtent ? 1 : 0;
+			if (inGrid[i]) cellSize = std::max(cellSize, extent);
+			else oversized[oversizedCount++] = static_cast<uint32_t>(i);
+		}
+		const float inverseCell = 1.0f / cellSize;
+		auto cellOf = [&](float value) { return static_cast<int>(std::floor(value * inverseCell)); };
+
+		//hashed cell lists, counting sorted so each bucket's particles sit together
+		uint32_t tableSize = 1;
+		while (tableSize < count * 2) tableSize <<= 1;
+		const uint32_t tableMask = tableSize - 1;
+		uint32_t* bucketStart = scratch.AllocateArray<uint32_t>(tableSize + 1);
+		uint32_t* bucket = scratch.AllocateArray<uint32_t>(count);
+		std::memset(bucketStart, 0, sizeof(uint32_t) * (tableSize + 1));
+		for (size_t i = 0; i < count; i++) {
+			if (!inGrid[i]) continue;
+			const Bounds& b = bounds[i];
+			bucket[i] = CellHash(cellOf((b.min[0] + b.max[0]) * 0.5f), cellOf((b.min[1] + b.max[1]) * 0.5f),
+				cellOf((b.min[2] + b.max[2]) * 0.5f)) & tableMask;
+			bucketStart[bucket[i] + 1]++;
+		}
+		for (uint32_t b = 0; b < tableSize; b++) bucketStart[b + 1] += bucketStart[b];
+		const uint32_t entryCount = bucketStart[tableSize];
+		//boxes are copied in bucket order so walking a bucket reads memory in a row
+		Entry* entries = scratch.AllocateArray<Entry>(count);
+		uint32_t* fill = scratch.AllocateArray<uint32_t>(tableSize);
+		std::memcpy(fill, bucketStart, sizeof(uint32_t) * tableSize);
+		for (size_t i = 0; i < count; i++) {
+			if (inGrid[i]) entries[fill[bucket[i]]++] = Entry{ bounds[i], static_cast<uint32_t>(i), fast[i] };
+		}
+
+		//only fast particles look for partners, two fast ones are tested from the lower index
+		//a pair found twice through colliding hashes only costs a second test, the later
+		//impact is skipped when resolving
+		float time;
+		auto test = [&](uint32_t f, const Bounds& b, uint32_t other, bool otherFast, const Bounds& otherBounds) {
+			if (other == f || (otherFast && other < f)) return;
+			if (!Overlaps(b, otherBounds)) return;
+			if (TimeOfImpact(start, end, f, other, time)) impacts.push_back(Impact{ time, f, other });
+		};
+		for (size_t i = 0; i < count; i++) {
+			if (!fast[i]) continue;
+			const uint32_t f = static_cast<uint32_t>(i);
+			const Bounds& b = bounds[i];
+
+			//any grid box touching this one has its center within half a cell of it
+			int lo[3], hi[3];
+			size_t cells = 1;
+			for (int a = 0; a < 3; a++) {
+				lo[a] = cellOf(b.min[a] - cellSize * 0.5f);
+				hi[a] = cellOf(b.max[a] + cellSize * 0.5f);
+				cells *= static_cast<size_t>(hi[a] - lo[a] + 1);
+			}
+			if (cells > entryCount) {
+				//long path over more cells than there are entries, reading them all is cheaper
+				for (uint32_t e = 0; e < entryCount; e++) test(f, b, entries[e].index, entries[e].fast != 0, entries[e].bounds);
+			}
+			else {
+				for (int x = lo[0]; x <= hi[0]; x++) {
+					for (int y = lo[1]; y <= hi[1]; y++) {
+						for (int z = lo[2]; z <= hi[2]; z++) {
+							const uint32_t cell = CellHash(x, y, z) & tableMask;
+							for (uint32_t e = bucketStart[cell]; e < bucketStart[cell + 1]; e++) {
+								test(f, b, entries[e].index, entries[e].fast != 0, entries[e].bounds);
+							}
+						}
+					}
+				}
+			}
+			for (size_t o = 0; o < oversizedCount; o++) {
+				test(f, b, oversized[o], fast[oversized[o]] != 0, bounds[oversized[o]]);
+			}
+		}
+	}
+
+	size_t ContinuousCollision::Resolve(const PackedParticles& start, float time,
+		const MeshCollider* const* colliders, size_t colliderCount,
+		const ParticleBoundary* const* boundaries, size_t boundaryCount, FrameArena& scratch) const {
+		const size_t count = start.count;
+		if (count == 0 || time <= 0.0f) return 0;
+		PhysicsParticle* const* particles = start.particles;
+
+		//where they ended up, gathered so the pair tests never touch the particles themselves
+		const PackedParticles end = PackedParticles::Gather(particles, count, scratch);
+		uint8_t* fast = scratch.AllocateArray<uint8_t>(count);
+		Path* paths = scratch.AllocateArray<Path>(count);
+		uint32_t* swept = scratch.AllocateArray<uint32_t>(count);
+		size_t sweptCount = 0;
+		for (size_t i = 0; i < count; i++) {
+			float dx = end.x[i] - start.x[i];
+			float dy = end.y[i] - start.y[i];
+			float dz = end.z[i] - start.z[i];
+			float limit = start.radius[i] * fastMotionScale;
+			fast[i] = dx * dx + dy * dy + dz * dz > limit * limit ? 1 : 0;
+			paths[i] = Path{ start.x[i], start.y[i], start.z[i], time };
+			if (fast[i]) swept[sweptCount++] = static_cast<uint32_t>(i);
+		}
+		if (sweptCount == 0) return 0;
+
+		//particle pairs, earliest first and one impact per particle per step
+		if (particleCollisions && count > 1) {
+			ArenaVector<Impact> impacts{ ArenaAllocator<Impact>(scratch) };
+			FindImpacts(start, end, fast, scratch, impacts);
+			std::sort(impacts.begin(), impacts.end(), [](const Impact& l, const Impact& r) { return l.time < r.time; });
+
+			uint8_t* hit = scratch.AllocateArray<uint8_t>(count);
+			std::memset(hit, 0, count);
+			for (const Impact& impact : impacts) {
+				if (hit[impact.a] || hit[impact.b]) continue;
+				hit[impact.a] = hit[impact.b] = 1;
+
+				//both back to where they touch
+				for (uint32_t i : { impact.a, impact.b }) {
+					MyVector from(start.x[i], start.y[i], start.z[i]);
+					particles[i]->Position = from + (particles[i]->Position - from) * impact.time;
+				}
+				MyVector normal = particles[impact.a]->Position - particles[impact.b]->Position;
+				if (normal.Magnitude() > 0.0f) {
+					ParticleContact contact;
+					contact.particles[0] = particles[impact.a];
+					contact.particles[1] = particles[impact.b];
+					contact.restitution = particleRestitution;
+					contact.contactNormal = normal.Direction();
+					contact.Resolve(time);
+				}
+
+				//rest of the step with the new velocities, static geometry still gets a say
+				for (uint32_t i : { impact.a, impact.b }) {
+					PhysicsParticle* particle = particles[i];
+					float remaining = time * (1.0f - impact.time);
+					paths[i] = Path{ particle->Position.x, particle->Position.y, particle->Position.z, remaining };
+					particle->Position = particle->Position + particle->Velocity * remaining;
+					if (!fast[i]) {
+						fast[i] = 1;
+						swept[sweptCount++] = i;
+					}
+				}
+			}
+		}
+
+		if (colliderCount == 0 && boundaryCount == 0) return sweptCount;
+
+		//static geometry, every swept particle only touches itself so they run in parallel
+		auto body = [&](size_t begin, size_t end) {
+			for (size_t s = begin; s < end; s++) {
+				PhysicsParticle* particle = particles[swept[s]];
+				const Path& path = paths[swept[s]];
+				const float radius = particle->radius;
+				MyVector from(path.x, path.y, path.z);
+				MyVector to = particle->Position;
+				float remaining = path.remaining;
+
+				for (int step = 0; step < maxSubsteps; step++) {
+					float first = 2.0f;
+					MyVector normal;
+					float restitution = 0.0f;
+
+					float t;
+					MyVector boundaryNormal;
+					for (size_t b = 0; b < boundaryCount; b++) {
+						if (boundaries[b]->Sweep(from, to, radius, t, boundaryNormal) && t < first) {
+							first = t;
+							normal = boundaryNormal;
+							restitution = boundaries[b]->GetRestitution();
+						}
+					}
+					glm::vec3 meshFrom(from.x, from.y, from.z);
+					glm::vec3 meshTo(to.x, to.y, to.z);
+					glm::vec3 meshNormal;
+					for (size_t c = 0; c < colliderCount; c++) {
+						if (colliders[c]->Sweep(meshFrom, meshTo, radius, t, meshNormal) && t < first) {
+							first = t;
+							normal = MyVector(meshNormal.x, meshNormal.y, meshNormal.z);
+							restitution = colliders[c]->GetRestitution();
+						}
+					}
+					if (first > 1.0f) break;
+
+					//same bounce a static contact gives, then carry on from the impact
+					MyVector impact = from + (to - from) * first;
+					float separatingSpeed = particle->Velocity.Dot(normal);
+					if (separatingSpeed < 0.0f) {
+						particle->Velocity += normal * (-(1.0f + restitution) * separatingSpeed);
+					}
+					remaining *= 1.0f - first;
+					from = impact;
+					//out of sub steps, stay at the last impact rather than risk passing through
+					to = step + 1 < maxSubsteps ? impact + particle->Velocity * remaining : impact;
+				}
+				particle->Position = to;
+			}
+		};
+		if (sweptCount < MinSweepsPerChunk * 2) body(0, sweptCount);
+		else ThreadPool::Shared().ParallelFor(sweptCount, MinSweepsPerChunk, body);
+		return sweptCount;
+	}
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "PhysicsParticle.h"
+#include "ParticleContact.h"
+#include "ParticleBoundary.h"
+#include "MeshCollider.h"
+#include "FrameArena.h"
+
+namespace Physics {
+	//continuous collision for particles that move further than their own size in one step
+	//runs after integration on the paths from the step's start positions to where they ended
+	//slow particles are left alone for the discrete contact pass, fast ones are swept:
+	//pairs found through a hashed grid get an analytic time of impact, colliders and
+	//boundaries their own sweeps, and every hit resolves the velocity and spends the rest of
+	//the step in another sub step
+	class ContinuousCollision {
+	public:
+		//particles moving more than this many radii in a step count as fast
+		void SetFastMotionScale(float value) { fastMotionScale = value; }
+		float GetFastMotionScale() const { return fastMotionScale; }
+
+		//hits one particle can resolve against static geometry in one step, it stops at the last one
+		void SetMaxSubsteps(int value) { maxSubsteps = value < 1 ? 1 : value; }
+		int GetMaxSubsteps() const { return maxSubsteps; }
+
+		//off leaves particles passing through each other and only sweeps against static geometry
+		void SetParticleCollisions(bool value) { particleCollisions = value; }
+		bool GetParticleCollisions() const { return particleCollisions; }
+
+		//bounciness of particle against particle impacts
+		void SetParticleRestitution(float value) { particleRestitution = value; }
+		float GetParticleRestitution() const { return particleRestitution; }
+
+		//start has every particle's position from before the step, the particles have already moved
+		//returns how many particles were swept
+		size_t Resolve(const PackedParticles& start, float time,
+			const MeshCollider* const* colliders, size_t colliderCount,
+			const ParticleBoundary* const* boundaries, size_t boundaryCount, FrameArena& scratch) const;
+
+	private:
+		//two particles meeting at time along the step, 0 to 1
+		struct Impact {
+			float time;
+			uint32_t a;
+			uint32_t b;
+		};
+
+		float fastMotionScale = 1.0f;
+		int maxSubsteps = 4;
+		float particleRestitution = 0.8f;
+		bool particleCollisions = true;
+
+		void FindImpacts(const PackedParticles& start, const PackedParticles& end, const uint8_t* fast,
+			FrameArena& scratch, ArenaVector<Impact>& impacts) const;
+	};
+}
@@ -2,14 +2,8 @@
 
 namespace Physics {
     void DragForceGenerator::UpdateForce(PhysicsParticle* particle, float time) {
-        MyVector force = MyVector(0, 0, 0);
-        MyVector currV = particle->Velocity;
-
-        float mag = currV.Magnitude();
-        if (mag <= 0) return;
-
-        float dragF = (k1 * mag) + (k2 * mag);
-        MyVector dir = currV.Direction();
-        particle->AddForce(dir * -dragF);
+        float force[3] = { 0, 0, 0 };
+        Accumulate(*particle, time, force);
+        particle->AddForce(MyVector(force[0], force[1], force[2]));
     }
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 #include "ForceGenerator.h"
+#include <cmath>
 
 namespace Physics {
 	class DragForceGenerator : public ForceGenerator {
@@ -14,5 +15,19 @@ namespace Physics {
 		DragForceGenerator(float _k1, float _k2): k1(_k1), k2(_k2){}
 
 		void UpdateForce(PhysicsParticle* particle, float time) override;
+
+		//adds drag against the velocity, k1 and k2 both scale with speed here
+		void Accumulate(const PhysicsParticle& particle, float time, float force[3]) const {
+			const MyVector& v = particle.Velocity;
+			float mag = std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+			if (mag <= 0) return;
+
+			//against the velocity, so direction * -drag is just velocity scaled
+			float dragF = (k1 * mag) + (k2 * mag);
+			float scale = -dragF / mag;
+			force[0] += v.x * scale;
+			force[1] += v.y * scale;
+			force[2] += v.z * scale;
+		}
 	};
 }
@@ -0,0 +1,370 @@
+#include "ForceField.h"
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <utility>
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#include <emmintrin.h>
+#define FORCEFIELD_USE_SSE
+#endif
+
+namespace Physics {
+	namespace {
+		const char Magic[4] = { 'Y', 'N', 'F', 'F' };
+		//largest grid a file may ask for, keeps a corrupt header from allocating gigabytes
+		const uint32_t MaxFileResolution = 1024;
+		const uint64_t MaxFileNodes = 256u * 256u * 256u;
+
+		uint32_t Hash(int x, int y, int z, uint32_t seed) {
+			uint32_t h = seed;
+			h ^= (uint32_t)x * 0x8da6b343u;
+			h ^= (uint32_t)y * 0xd8163841u;
+			h ^= (uint32_t)z * 0xcb1ab31fu;
+			h ^= h >> 15;
+			h *= 0x2c1b3c6du;
+			h ^= h >> 12;
+			h *= 0x297a2d39u;
+			h ^= h >> 15;
+			return h;
+		}
+
+		//-1 to 1 at each lattice point
+		float Lattice(int x, int y, int z, uint32_t seed) {
+			return (float)(Hash(x, y, z, seed) & 0xffffff) * (2.0f / 16777215.0f) - 1.0f;
+		}
+
+		float Fade(float t) {
+			return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+		}
+
+		float Lerp(float a, float b, float t) {
+			return a + (b - a) * t;
+		}
+
+		//smooth value noise, continuous first derivative so the curl has no seams
+		float Noise(float x, float y, float z, uint32_t seed) {
+			float fx = std::floor(x), fy = std::floor(y), fz = std::floor(z);
+			int ix = (int)fx, iy = (int)fy, iz = (int)fz;
+			float tx = Fade(x - fx), ty = Fade(y - fy), tz = Fade(z - fz);
+
+			float c00 = Lerp(Lattice(ix, iy, iz, seed), Lattice(ix + 1, iy, iz, seed), tx);
+			float c10 = Lerp(Lattice(ix, iy + 1, iz, seed), Lattice(ix + 1, iy + 1, iz, seed), tx);
+			float c01 = Lerp(Lattice(ix, iy, iz + 1, seed), Lattice(ix + 1, iy, iz + 1, seed), tx);
+			float c11 = Lerp(Lattice(ix, iy + 1, iz + 1, seed), Lattice(ix + 1, iy + 1, iz + 1, seed), tx);
+			return Lerp(Lerp(c00, c10, ty), Lerp(c01, c11, ty), tz);
+		}
+	}
+
+	MyVector ForceField::Grid::NodePosition(int x, int y, int z) const {
+		return MyVector(min[0] + x * spacing[0], min[1] + y * spacing[1], min[2] + z * spacing[2]);
+	}
+
+	void ForceField::Grid::Set(int x, int y, int z, const MyVector& value) {
+		float* node = &nodes[(((size_t)z * resolutionY + y) * resolutionX + x) * 4];
+		node[0] = value.x;
+		node[1] = value.y;
+		node[2] = value.z;
+		node[3] = 0.0f;
+	}
+
+	MyVector ForceField::Grid::Get(int x, int y, int z) const {
+		const float* node = &nodes[(((size_t)z * resolutionY + y) * resolutionX + x) * 4];
+		return MyVector(node[0], node[1], node[2]);
+	}
+
+	ForceField::ForceField(int resolutionX, int resolutionY, int resolutionZ, const MyVector& min, const MyVector& max)
+		: front(&grids[0]), back(&grids[1]) {
+		const float low[3] = { min.x, min.y, min.z };
+		const float high[3] = { max.x, max.y, max.z };
+		Resize(grids[0], resolutionX, resolutionY, resolutionZ, low, high);
+		Resize(grids[1], resolutionX, resolutionY, resolutionZ, low, high);
+	}
+
+	ForceField::~ForceField() {
+		StopAnimation();
+	}
+
+	void ForceField::Resize(Grid& grid, int resolutionX, int resolutionY, int resolutionZ,
+		const float min[3], const float max[3]) {
+		const int resolution[3] = { resolutionX < 2 ? 2 : resolutionX, resolutionY < 2 ? 2 : resolutionY, resolutionZ < 2 ? 2 : resolutionZ };
+		grid.resolutionX = resolution[0];
+		grid.resolutionY = resolution[1];
+		grid.resolutionZ = resolution[2];
+		for (int axis = 0; axis < 3; axis++) {
+			grid.min[axis] = min[axis];
+			float extent = max[axis] - min[axis];
+			grid.spacing[axis] = extent > 0.0f ? extent / (resolution[axis] - 1) : 1.0f;
+		}
+		grid.nodes.assign((size_t)resolution[0] * resolution[1] * resolution[2] * 4, 0.0f);
+	}
+
+	void ForceField::BuildCurlNoise(Grid& grid, uint32_t seed, float frequency, float amplitude, float time) {
+		//three potentials, each drifting its own way over time so the flow changes shape
+		//instead of just sliding along
+		const uint32_t seeds[3] = { seed, seed + 0x9e3779b9u, seed + 0x3c6ef372u };
+		const float drift[3][3] = { { 0.0f, 0.37f, 0.71f }, { 0.53f, 0.0f, 0.29f }, { 0.41f, 0.67f, 0.0f } };
+		const float step = 0.01f; //finite difference, in noise space
+		const float scale = amplitude / (2.0f * step);
+
+		for (int z = 0; z < grid.resolutionZ; z++) {
+			for (int y = 0; y < grid.resolutionY; y++) {
+				for (int x = 0; x < grid.resolutionX; x++) {
+					MyVector position = grid.NodePosition(x, y, z);
+					float p[3][3];
+					for (int c = 0; c < 3; c++) {
+						p[c][0] = position.x * frequency + drift[c][0] * time;
+						p[c][1] = position.y * frequency + drift[c][1] * time;
+						p[c][2] = position.z * frequency + drift[c][2] * time;
+					}
+					auto potential = [&](int c, float dx, float dy, float dz) {
+						return Noise(p[c][0] + dx, p[c][1] + dy, p[c][2] + dz, seeds[c]);
+					};
+
+					//curl = (dz/dy - dy/dz, dx/dz - dz/dx, dy/dx - dx/dy) of the potentials
+					float dZdy = potential(2, 0, step, 0) - potential(2, 0, -step, 0);
+					float dYdz = potential(1, 0, 0, step) - potential(1, 0, 0, -step);
+					float dXdz = potential(0, 0, 0, step) - potential(0, 0, 0, -step);
+					float dZdx = potential(2, step, 0, 0) - potential(2, -step, 0, 0);
+					float dYdx = potential(1, step, 0, 0) - potential(1, -step, 0, 0);
+					float dXdy = potential(0, 0, step, 0) - potential(0, 0, -step, 0);
+					grid.Set(x, y, z, MyVector((dZdy - dYdz) * scale, (dXdz - dZdx) * scale, (dYdx - dXdy) * scale));
+				}
+			}
+		}
+	}
+
+	bool ForceField::LoadBinary(const std::string& path) {
+		std::ifstream file(path, std::ios::binary);
+		if (!file) {
+			std::cout << "ERROR::FORCEFIELD::FAILED_TO_OPEN: " << path << std::endl;
+			return false;
+		}
+
+		char magic[4];
+		uint32_t resolution[3];
+		float min[3], max[3];
+		file.read(magic, sizeof(magic));
+		file.read(reinterpret_cast<char*>(resolution), sizeof(resolution));
+		file.read(reinterpret_cast<char*>(min), sizeof(min));
+		file.read(reinterpret_cast<char*>(max), sizeof(max));
+		if (!file || std::memcmp(magic, Magic, sizeof(Magic)) != 0) {
+			std::cout << "ERROR::FORCEFIELD::BAD_HEADER: " << path << std::endl;
+			return false;
+		}
+		for (int axis = 0; axis < 3; axis++) {
+			if (resolution[axis] < 2 || resolution[axis] > MaxFileResolution || !(max[axis] > min[axis])) {
+				std::cout << "ERROR::FORCEFIELD::BAD_HEADER: " << path << std::endl;
+				return false;
+			}
+		}
+		uint64_t nodeCount = (uint64_t)resolution[0] * resolution[1] * resolution[2];
+		if (nodeCount > MaxFileNodes) {
+			std::cout << "ERROR::FORCEFIELD::TOO_LARGE: " << path << std::endl;
+			return false;
+		}
+
+		std::vector<float> values((size_t)nodeCount * 3);
+		file.read(reinterpret_cast<char*>(values.data()), values.size() * sizeof(float));
+		if (!file) {
+			std::cout << "ERROR::FORCEFIELD::TRUNCATED: " << path << std::endl;
+			return false;
+		}
+
+		//the builder writes into the grids, so it has to be gone before they change size
+		StopAnimation();
+		Resize(grids[0], (int)resolution[0], (int)resolution[1], (int)resolution[2], min, max);
+		Resize(grids[1], (int)resolution[0], (int)resolution[1], (int)resolution[2], min, max);
+		for (size_t i = 0; i < (size_t)nodeCount; i++) {
+			front->nodes[i * 4 + 0] = values[i * 3 + 0];
+			front->nodes[i * 4 + 1] = values[i * 3 + 1];
+			front->nodes[i * 4 + 2] = values[i * 3 + 2];
+		}
+		return true;
+	}
+
+	bool ForceField::SaveBinary(const std::string& path) const {
+		std::ofstream file(path, std::ios::binary);
+		if (!file) {
+			std::cout << "ERROR::FORCEFIELD::FAILED_TO_OPEN: " << path << std::endl;
+			return false;
+		}
+
+		const Grid& grid = *front;
+		const uint32_t resolution[3] = { (uint32_t)grid.resolutionX, (uint32_t)grid.resolutionY, (uint32_t)grid.resolutionZ };
+		float max[3];
+		for (int axis = 0; axis < 3; axis++) max[axis] = grid.min[axis] + grid.spacing[axis] * (resolution[axis] - 1);
+		file.write(Magic, sizeof(Magic));
+		file.write(reinterpret_cast<const char*>(resolution), sizeof(resolution));
+		file.write(reinterpret_cast<const char*>(grid.min), sizeof(grid.min));
+		file.write(reinterpret_cast<const char*>(max), sizeof(max));
+		for (size_t i = 0; i < grid.nodes.size(); i += 4) {
+			file.write(reinterpret_cast<const char*>(&grid.nodes[i]), 3 * sizeof(float));
+		}
+		if (!file) {
+			std::cout << "ERROR::FORCEFIELD::FAILED_TO_WRITE: " << path << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	void ForceField::Animate(std::function<void(Grid&, float)> build, float period) {
+		StopAnimation();
+		this->build = std::move(build);
+		this->period = period > 0.0f ? period : 0.0f;
+		clock = 0.0f;
+
+		//first frame is built here so there is something to sample straight away
+		this->build(*front, 0.0f);
+		if (this->period <= 0.0f) return;
+
+		stopping = false;
+		buildReady = false;
+		buildRequested = false;
+		builder = std::thread(&ForceField::BuilderLoop, this);
+		RequestBuild(this->period);
+	}
+
+	void ForceField::StopAnimation() {
+		if (!builder.joinable()) return;
+		{
+			std::lock_guard<std::mutex> lock(buildMutex);
+			stopping = true;
+		}
+		buildChanged.notify_all();
+		builder.join();
+		buildRequested = false;
+		buildReady = false;
+	}
+
+	void ForceField::Update(float deltaTime) {
+		if (!builder.joinable()) return;
+		clock += deltaTime;
+		if (clock < nextBuild) return;
+
+		//a build that is late keeps the old field for another step rather than stalling the sim
+		std::unique_lock<std::mutex> lock(buildMutex);
+		if (!buildReady) return;
+		std::swap(front, back);
+		buildReady = false;
+		//skip keyframes that were missed during a long hitch
+		float next = nextBuild + period;
+		while (next <= clock) next += period;
+		lock.unlock();
+		RequestBuild(next);
+	}
+
+	void ForceField::RequestBuild(float time) {
+		{
+			std::lock_guard<std::mutex> lock(buildMutex);
+			nextBuild = time;
+			buildRequested = true;
+		}
+		buildChanged.notify_one();
+	}
+
+	void ForceField::BuilderLoop() {
+		std::unique_lock<std::mutex> lock(buildMutex);
+		while (true) {
+			buildChanged.wait(lock, [this] { return buildRequested || stopping; });
+			if (stopping) return;
+			Grid& target = *back;
+			float time = nextBuild;
+			buildRequested = false;
+
+			//the sim only touches back once buildReady is set, so this runs unlocked
+			lock.unlock();
+			build(target, time);
+			lock.lock();
+			buildReady = true;
+		}
+	}
+
+	void ForceField::SampleInto(const float position[3], float force[3]) const {
+		const Grid& grid = *front;
+		const int resolution[3] = { grid.resolutionX, grid.resolutionY, grid.resolutionZ };
+		int cell[3];
+		float t[3];
+		for (int axis = 0; axis < 3; axis++) {
+			float u = (position[axis] - grid.min[axis]) / grid.spacing[axis];
+			//also false for nan
+			if (!(u >= 0.0f && u <= (float)(resolution[axis] - 1))) return;
+			int i = (int)u;
+			if (i > resolution[axis] - 2) i = resolution[axis] - 2;
+			cell[axis] = i;
+			t[axis] = u - (float)i;
+		}
+
+		const size_t strideY = (size_t)resolution[0] * 4;
+		const size_t strideZ = strideY * resolution[1];
+		const float* n000 = &grid.nodes[(size_t)cell[2] * strideZ + (size_t)cell[1] * strideY + (size_t)cell[0] * 4];
+		const float* n010 = n000 + strideY;
+		const float* n001 = n000 + strideZ;
+		const float* n011 = n001 + strideY;
+
+#ifdef FORCEFIELD_USE_SSE
+		//xyz of a node in one register, the eight corners fold down x, then y, then z
+		__m128 tx = _mm_set1_ps(t[0]);
+		__m128 a = _mm_loadu_ps(n000), b = _mm_loadu_ps(n000 + 4);
+		__m128 c00 = _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), tx));
+		a = _mm_loadu_ps(n010); b = _mm_loadu_ps(n010 + 4);
+		__m128 c10 = _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), tx));
+		a = _mm_loadu_ps(n001); b = _mm_loadu_ps(n001 + 4);
+		__m128 c01 = _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), tx));
+		a = _mm_loadu_ps(n011); b = _mm_loadu_ps(n011 + 4);
+		__m128 c11 = _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), tx));
+
+		__m128 ty = _mm_set1_ps(t[1]);
+		__m128 c0 = _mm_add_ps(c00, _mm_mul_ps(_mm_sub_ps(c10, c00), ty));
+		__m128 c1 = _mm_add_ps(c01, _mm_mul_ps(_mm_sub_ps(c11, c01), ty));
+		__m128 c = _mm_add_ps(c0, _mm_mul_ps(_mm_sub_ps(c1, c0), _mm_set1_ps(t[2])));
+		c = _mm_mul_ps(c, _mm_set1_ps(strength));
+
+		float result[4];
+		_mm_storeu_ps(result, c);
+		force[0] += result[0];
+		force[1] += result[1];
+		force[2] += result[2];
+#else
+		for (int k = 0; k < 3; k++) {
+			float c00 = Lerp(n000[k], n000[k + 4], t[0]);
+			float c10 = Lerp(n010[k], n010[k + 4], t[0]);
+			float c01 = Lerp(n001[k], n001[k + 4], t[0]);
+			float c11 = Lerp(n011[k], n011[k + 4], t[0]);
+			force[k] += Lerp(Lerp(c00, c10, t[1]), Lerp(c01, c11, t[1]), t[2]) * strength;
+		}
+#endif
+	}
+
+	MyVector ForceField::Sample(const MyVector& position) const {
+		const float p[3] = { position.x, position.y, position.z };
+		float force[3] = { 0, 0, 0 };
+		SampleInto(p, force);
+		return MyVector(force[0], force[1], force[2]);
+	}
+
+	void ForceField::SampleBatch(const float* x, const float* y, const float* z, size_t count,
+		float* forceX, float* forceY, float* forceZ) const {
+		for (size_t i = 0; i < count; i++) {
+			const float p[3] = { x[i], y[i], z[i] };
+			float force[3] = { 0, 0, 0 };
+			SampleInto(p, force);
+			forceX[i] = force[0];
+			forceY[i] = force[1];
+			forceZ[i] = force[2];
+		}
+	}
+
+	void ForceField::Accumulate(const PhysicsParticle& particle, float time, float force[3]) const {
+		if (particle.mass <= 0) return;
+		const float p[3] = { particle.Position.x, particle.Position.y, particle.Position.z };
+		SampleInto(p, force);
+	}
+
+	void ForceField::UpdateForce(PhysicsParticle* particle, float time) {
+		float force[3] = { 0, 0, 0 };
+		Accumulate(*particle, time, force);
+		particle->AddForce(MyVector(force[0], force[1], force[2]));
+	}
+}
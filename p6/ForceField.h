@@ -0,0 +1,115 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+#include "ForceGenerator.h"
+
+namespace Physics {
+	//force that depends on where the particle is, read from a 3D grid of vectors with trilinear
+	//interpolation, wind, vortices or turbulence without scripting particles one by one
+	//the grid spans min to max, outside it the field adds nothing
+	//nodes are stored as four floats so one corner is one SSE load and a sample is 8 loads
+	//and 7 vector lerps
+	class ForceField : public ForceGenerator {
+	public:
+		//resolution is nodes per axis, at least 2 each
+		ForceField(int resolutionX, int resolutionY, int resolutionZ, const MyVector& min, const MyVector& max);
+		~ForceField();
+
+		ForceField(const ForceField&) = delete;
+		ForceField& operator=(const ForceField&) = delete;
+
+		//vectors on the grid, written by Fill, the loaders and animation builds
+		class Grid {
+		public:
+			int GetResolutionX() const { return resolutionX; }
+			int GetResolutionY() const { return resolutionY; }
+			int GetResolutionZ() const { return resolutionZ; }
+			//world position of node (x, y, z)
+			MyVector NodePosition(int x, int y, int z) const;
+			void Set(int x, int y, int z, const MyVector& value);
+			MyVector Get(int x, int y, int z) const;
+
+		private:
+			friend class ForceField;
+			int resolutionX = 0, resolutionY = 0, resolutionZ = 0;
+			float min[3] = { 0, 0, 0 };
+			float spacing[3] = { 1, 1, 1 };
+			std::vector<float> nodes; //xyz and padding per node, x fastest
+		};
+
+		//sets every node from its world position, value(position) -> force
+		template <typename F>
+		void Fill(const F& value) {
+			Grid& grid = *front;
+			for (int z = 0; z < grid.resolutionZ; z++)
+				for (int y = 0; y < grid.resolutionY; y++)
+					for (int x = 0; x < grid.resolutionX; x++)
+						grid.Set(x, y, z, value(grid.NodePosition(x, y, z)));
+		}
+
+		//divergence free turbulence, the curl of three noise fields, so particles swirl instead
+		//of bunching up, time slides the noise so successive builds flow into each other
+		static void BuildCurlNoise(Grid& grid, uint32_t seed, float frequency, float amplitude, float time);
+		void FillCurlNoise(uint32_t seed, float frequency, float amplitude) {
+			BuildCurlNoise(*front, seed, frequency, amplitude, 0.0f);
+		}
+
+		//binary field, little endian:
+		//"YNFF", uint32 resolution x y z, float min xyz, float max xyz, then xyz per node, x fastest
+		//the file's resolution and bounds replace the field's, returns false and keeps the old
+		//field if the file is missing or malformed
+		bool LoadBinary(const std::string& path);
+		bool SaveBinary(const std::string& path) const;
+
+		//rebuilds the field every period seconds of Update time on a background thread, into a
+		//second grid, so sampling never waits, build(grid, time) fills the whole grid
+		void Animate(std::function<void(Grid&, float)> build, float period);
+		void StopAnimation();
+		//advances the animation clock and swaps in a finished build, call between steps
+		void Update(float deltaTime);
+
+		//force is the sample times strength
+		void SetStrength(float value) { strength = value; }
+		float GetStrength() const { return strength; }
+
+		MyVector Sample(const MyVector& position) const;
+		//samples count positions at once, out arrays get the force, strength applied
+		void SampleBatch(const float* x, const float* y, const float* z, size_t count,
+			float* forceX, float* forceY, float* forceZ) const;
+
+		//ForcePipeline side
+		void Accumulate(const PhysicsParticle& particle, float time, float force[3]) const;
+		//registry side
+		void UpdateForce(PhysicsParticle* particle, float time) override;
+
+	private:
+		Grid grids[2];
+		Grid* front; //sampled
+		Grid* back; //built by the animation thread
+		float strength = 1.0f;
+
+		//animation
+		std::function<void(Grid&, float)> build;
+		float period = 0.0f;
+		float clock = 0.0f;
+		float nextBuild = 0.0f; //time the back grid is being built for
+		std::thread builder;
+		std::mutex buildMutex;
+		std::condition_variable buildChanged;
+		bool buildRequested = false;
+		bool buildReady = false;
+		bool stopping = false;
+
+		void SampleInto(const float position[3], float force[3]) const;
+		void RequestBuild(float time);
+		void BuilderLoop();
+		static void Resize(Grid& grid, int resolutionX, int resolutionY, int resolutionZ,
+			const float min[3], const float max[3]);
+	};
+}
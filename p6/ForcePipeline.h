@@ -0,0 +1,64 @@
+#pragma once
+#include <tuple>
+#include <utility>
+#include <cstddef>
+#include "PhysicsParticle.h"
+#include "ThreadPool.h"
+
+namespace Physics {
+	//forces every particle in the world gets, run as one pass instead of one registry entry each
+	class ForcePipelineBase {
+	public:
+		virtual ~ForcePipelineBase() {}
+		virtual void Apply(PhysicsParticle* const* particles, size_t count, float time) = 0;
+	};
+
+	//generators fixed at compile time, each needs an inline
+	//Accumulate(const PhysicsParticle&, float time, float force[3]) const
+	//all of them are summed in one loop and the particle gets a single AddForce, so there is
+	//no virtual call per particle and the compiler can inline and fuse the whole lot
+	//e.g. ForcePipeline<GravityForceGenerator, DragForceGenerator>
+	//a generator can also be a pointer, for ones that can not be copied or are shared,
+	//e.g. ForcePipeline<GravityForceGenerator, ForceField*>
+	template <typename... Generators>
+	class ForcePipeline : public ForcePipelineBase {
+	public:
+		explicit ForcePipeline(Generators... generators) : generators(std::move(generators)...) {}
+
+		void Apply(PhysicsParticle* const* particles, size_t count, float time) override {
+			auto body = [&](size_t begin, size_t end) {
+				for (size_t i = begin; i < end; i++) {
+					PhysicsParticle& particle = *particles[i];
+					float force[3] = { 0, 0, 0 };
+					AccumulateAll(particle, time, force, std::index_sequence_for<Generators...>());
+					particle.AddForce(MyVector(force[0], force[1], force[2]));
+				}
+			};
+			if (count < MinParticlesPerChunk * 2) body(0, count);
+			else ThreadPool::Shared().ParallelFor(count, MinParticlesPerChunk, body);
+		}
+
+		//the generator at Index, to change its settings between steps
+		template <size_t Index>
+		typename std::tuple_element<Index, std::tuple<Generators...>>::type& Get() {
+			return std::get<Index>(generators);
+		}
+
+	private:
+		static const size_t MinParticlesPerChunk = 4096;
+
+		std::tuple<Generators...> generators;
+
+		template <typename T>
+		static const T& Deref(const T& generator) { return generator; }
+		template <typename T>
+		static const T& Deref(T* const& generator) { return *generator; }
+
+		template <size_t... Index>
+		void AccumulateAll(const PhysicsParticle& particle, float time, float force[3], std::index_sequence<Index...>) const {
+			//runs them in order, c++14 has no fold expressions
+			int expand[] = { 0, (Deref(std::get<Index>(generators)).Accumulate(particle, time, force), 0)... };
+			(void)expand;
+		}
+	};
+}
@@ -1,4 +1,5 @@
 #include "ForceRegistry.h"
+#include <algorithm>
 
 namespace Physics {
 
@@ -14,14 +15,30 @@ namespace Physics {
 	}
 
 	void ForceRegistry::Remove(PhysicsParticle* particle, ForceGenerator* generator) {
-		Registry.remove_if(
+		Registry.erase(std::remove_if(Registry.begin(), Registry.end(),
 			//gets specific part of particle and generator
 			//then removes
-			[particle, generator](ParticleForceRegistry reg) {
+			[particle, generator](const ParticleForceRegistry& reg) {
 				return reg.particle == particle &&
 					reg.generator == generator;
 			}
-		);
+		), Registry.end());
+	}
+
+	void ForceRegistry::RemoveGenerator(ForceGenerator* generator) {
+		Registry.erase(std::remove_if(Registry.begin(), Registry.end(),
+			[generator](const ParticleForceRegistry& reg) {
+				return reg.generator == generator;
+			}
+		), Registry.end());
+	}
+
+	void ForceRegistry::RemoveDestroyed() {
+		Registry.erase(std::remove_if(Registry.begin(), Registry.end(),
+			[](const ParticleForceRegistry& reg) {
+				return reg.particle->IsDestroyed();
+			}
+		), Registry.end());
 	}
 
 	void ForceRegistry::Clear() {
@@ -29,10 +46,8 @@ namespace Physics {
 	}
 
 	void ForceRegistry::UpdateForces(float time) {
-		for (std::list<ParticleForceRegistry>::iterator i = Registry.begin();
-			i != Registry.end();
-			i++) {
-			i->generator->UpdateForce(i->particle, time);
+		for (ParticleForceRegistry& entry : Registry) {
+			entry.generator->UpdateForce(entry.particle, time);
 		}
 	}
 }
\ No newline at end of file
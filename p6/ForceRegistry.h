@@ -3,7 +3,7 @@
 #include "PhysicsParticle.h"
 #include "ForceGenerator.h"
 
-#include "list"
+#include <vector>
 
 namespace Physics {
 	class ForceRegistry {
@@ -12,6 +12,10 @@ namespace Physics {
 	public:
 		void Add(PhysicsParticle* particle, ForceGenerator* generator);
 		void Remove(PhysicsParticle* particle, ForceGenerator* generator);
+		//drops every entry using generator, whatever the particle
+		void RemoveGenerator(ForceGenerator* generator);
+		//drops every entry whose particle is marked destroyed, one pass over the registry
+		void RemoveDestroyed();
 		void Clear();
 		void UpdateForces(float time);
 
@@ -21,6 +25,7 @@ namespace Physics {
 			ForceGenerator* generator;
 		};
 
-		std::list<ParticleForceRegistry> Registry;
+		//vector so compaction and the force pass are straight walks over memory
+		std::vector<ParticleForceRegistry> Registry;
 	};
 }
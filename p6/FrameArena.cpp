@@ -0,0 +1,135 @@
+#include "FrameArena.h"
+#include <algorithm>
+#include <new>
+
+namespace Physics {
+	FrameArena::FrameArena(size_t initialCapacity) {
+		blocks.push_back(NewBlock(std::max<size_t>(initialCapacity, 256)));
+	}
+
+	FrameArena::~FrameArena() {
+		for (Block& block : blocks) ::operator delete(block.data);
+	}
+
+	FrameArena::Block FrameArena::NewBlock(size_t size) {
+		return Block{ static_cast<char*>(::operator new(size)), size };
+	}
+
+	void* FrameArena::Allocate(size_t bytes, size_t alignment) {
+		for (;;) {
+			Block& block = blocks[current];
+			uintptr_t start = reinterpret_cast<uintptr_t>(block.data) + offset;
+			uintptr_t aligned = (start + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+			size_t end = static_cast<size_t>(aligned - reinterpret_cast<uintptr_t>(block.data)) + bytes;
+			if (end <= block.size) {
+				used += end - offset;
+				highWater = std::max(highWater, used);
+				offset = end;
+				return reinterpret_cast<void*>(aligned);
+			}
+
+			//the unused tail still counts so the merged block is big enough next time
+			const size_t size = block.size;
+			used += size - offset;
+			//past the end, chain a bigger block, Reset folds them back into one
+			if (current + 1 == blocks.size()) {
+				blocks.push_back(NewBlock(std::max(size * 2, bytes + alignment)));
+			}
+			current++;
+			offset = 0;
+		}
+	}
+
+	void FrameArena::Reset() {
+		if (blocks.size() > 1) {
+			size_t total = 0;
+			for (Block& block : blocks) {
+				total += block.size;
+				::operator delete(block.data);
+			}
+			blocks.clear();
+			blocks.push_back(NewBlock(std::max(total, highWater)));
+		}
+		current = 0;
+		offset = 0;
+		used = 0;
+	}
+
+	FrameArena::Stats FrameArena::GetStats() const {
+		Stats stats = { used, highWater, 0, blocks.size() };
+		for (const Block& block : blocks) stats.capacity += block.size;
+		return stats;
+	}
+
+	std::atomic<uint64_t> FrameArenas::nextId(1);
+
+	namespace {
+		//recently used (set, arena) pairs for this thread, checked before taking the lock
+		struct LocalCacheEntry {
+			uint64_t owner;
+			FrameArena* arena;
+		};
+		const int LocalCacheSize = 8;
+		thread_local LocalCacheEntry localCache[LocalCacheSize] = {};
+		thread_local int localCacheNext = 0;
+	}
+
+	FrameArenas::FrameArenas(size_t initialCapacity)
+		: id(nextId++), initialCapacity(initialCapacity) {
+	}
+
+	FrameArenas::~FrameArenas() {
+	}
+
+	FrameArena& FrameArenas::Local() {
+		for (const LocalCacheEntry& entry : localCache) {
+			if (entry.owner == id) return *entry.arena;
+		}
+		return LocalSlow();
+	}
+
+	FrameArena& FrameArenas::LocalSlow() {
+		FrameArena* arena = nullptr;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			const std::thread::id self = std::this_thread::get_id();
+			for (auto& entry : arenas) {
+				if (entry.first == self) {
+					arena = entry.second.get();
+					break;
+				}
+			}
+			if (!arena) {
+				arenas.emplace_back(self, std::unique_ptr<FrameArena>(new FrameArena(initialCapacity)));
+				arena = arenas.back().second.get();
+			}
+		}
+
+		localCache[localCacheNext] = LocalCacheEntry{ id, arena };
+		localCacheNext = (localCacheNext + 1) % LocalCacheSize;
+		return *arena;
+	}
+
+	void FrameArenas::Reset() {
+		std::lock_guard<std::mutex> lock(mutex);
+		for (auto& entry : arenas) entry.second->Reset();
+	}
+
+	FrameArena::Stats FrameArenas::GetStats() const {
+		std::lock_guard<std::mutex> lock(mutex);
+		FrameArena::Stats total = { 0, 0, 0, 0 };
+		for (const auto& entry : arenas) {
+			FrameArena::Stats stats = entry.second->GetStats();
+			total.used += stats.used;
+			total.highWater += stats.highWater;
+			total.capacity += stats.capacity;
+			total.blocks += stats.blocks;
+		}
+		return total;
+	}
+
+	size_t FrameArenas::GetArenaCount() const {
+		std::lock_guard<std::mutex> lock(mutex);
+		return arenas.size();
+	}
+}
@@ -0,0 +1,115 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace Physics {
+	//bump allocator for data that only lives until the next Reset, usually one step or frame
+	//allocations just move an offset, nothing is freed one by one
+	//when a frame runs past the first block extra blocks are chained on, and the next Reset
+	//merges them into one block the size of the high water mark, so a steady frame never
+	//touches the heap
+	class FrameArena {
+	public:
+		struct Stats {
+			size_t used; //bytes handed out since the last Reset, padding included
+			size_t highWater; //most ever used between two Resets
+			size_t capacity; //bytes reserved across all blocks
+			size_t blocks;
+		};
+
+		explicit FrameArena(size_t initialCapacity = 64 * 1024);
+		~FrameArena();
+
+		FrameArena(const FrameArena&) = delete;
+		FrameArena& operator=(const FrameArena&) = delete;
+
+		void* Allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+
+		//uninitialized storage for count objects, only for types that need no destructor
+		template <typename T>
+		T* AllocateArray(size_t count) {
+			static_assert(std::is_trivially_destructible<T>::value, "arena memory is never destructed");
+			return static_cast<T*>(Allocate(sizeof(T) * count, alignof(T)));
+		}
+
+		//forgets every allocation, pointers from before are invalid afterwards
+		void Reset();
+
+		Stats GetStats() const;
+
+	private:
+		struct Block {
+			char* data;
+			size_t size;
+		};
+
+		Block NewBlock(size_t size);
+
+		std::vector<Block> blocks;
+		size_t current = 0; //block being bumped
+		size_t offset = 0; //into the current block
+		size_t used = 0;
+		size_t highWater = 0;
+	};
+
+	//one FrameArena per thread that asks for one, all rewound together
+	//lets pool tasks grab scratch memory without locking or sharing a bump pointer
+	class FrameArenas {
+	public:
+		explicit FrameArenas(size_t initialCapacity = 64 * 1024);
+		~FrameArenas();
+
+		FrameArenas(const FrameArenas&) = delete;
+		FrameArenas& operator=(const FrameArenas&) = delete;
+
+		//arena for the calling thread, made on its first call
+		FrameArena& Local();
+
+		//rewinds every arena, no other thread may be allocating from them while this runs
+		void Reset();
+
+		//summed over every thread's arena
+		FrameArena::Stats GetStats() const;
+		size_t GetArenaCount() const;
+
+	private:
+		FrameArena& LocalSlow();
+
+		const uint64_t id; //never reused, so a stale thread cache entry can not match a new set
+		size_t initialCapacity;
+		mutable std::mutex mutex;
+		std::vector<std::pair<std::thread::id, std::unique_ptr<FrameArena>>> arenas;
+
+		static std::atomic<uint64_t> nextId;
+	};
+
+	//standard allocator over a FrameArena so containers can live in it, deallocate does nothing
+	template <typename T>
+	struct ArenaAllocator {
+		typedef T value_type;
+
+		FrameArena* arena;
+
+		explicit ArenaAllocator(FrameArena& arena) : arena(&arena) {}
+		template <typename U>
+		ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+		T* allocate(size_t count) { return static_cast<T*>(arena->Allocate(sizeof(T) * count, alignof(T))); }
+		void deallocate(T*, size_t) {}
+	};
+
+	template <typename T, typename U>
+	bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) { return a.arena == b.arena; }
+	template <typename T, typename U>
+	bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) { return a.arena != b.arena; }
+
+	//vector for one step's worth of data, reserve up front since growing leaves the old copy behind
+	template <typename T>
+	using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+}
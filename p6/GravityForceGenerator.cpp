@@ -2,10 +2,8 @@
 
 namespace Physics {
 	void GravityForceGenerator::UpdateForce(PhysicsParticle* particle, float time) {
-		if (particle->mass <= 0) return;
-
-		//f =  A  *  m
-		MyVector Force = Gravity * particle->mass;
-		particle->AddForce(Force);
+		float force[3] = { 0, 0, 0 };
+		Accumulate(*particle, time, force);
+		particle->AddForce(MyVector(force[0], force[1], force[2]));
 	}
-}
\ No newline at end of file
+}
@@ -9,5 +9,15 @@ namespace Physics {
 	public:
 		GravityForceGenerator(const MyVector gravity) : Gravity(gravity) {}
 		void UpdateForce(PhysicsParticle* particle, float time) override;
+
+		//adds weight, gravity times mass, massless particles feel nothing
+		void Accumulate(const PhysicsParticle& particle, float time, float force[3]) const {
+			if (particle.mass <= 0) return;
+
+			//f =  A  *  m
+			force[0] += Gravity.x * particle.mass;
+			force[1] += Gravity.y * particle.mass;
+			force[2] += Gravity.z * particle.mass;
+		}
 	};
 }
@@ -0,0 +1,145 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cmath>
+
+namespace Physics {
+	//hierarchical timing wheel for expiry times
+	//items sit in a bucket for the tick they expire on and are only touched again when a
+	//coarser bucket cascades down or they expire, so a step costs O(expiring) not O(alive)
+	//levels cover 256 ticks, then 64 x 256 and 64 x 16384, anything further waits in overflow
+	//buckets are linked lists through one shared node array, so once the wheel has held its
+	//peak number of items Add and Advance never allocate
+	template <typename Handle>
+	class LifetimeWheel {
+	public:
+		//tickLength is the expiry resolution in seconds, usually the simulation step
+		explicit LifetimeWheel(float tickLength = 1.0f / 60.0f) : tickLength(tickLength) {
+			for (uint32_t& bucket : level0) bucket = NoNode;
+			for (uint32_t& bucket : level1) bucket = NoNode;
+			for (uint32_t& bucket : level2) bucket = NoNode;
+		}
+
+		//seconds since the wheel started
+		float Now() const { return static_cast<float>(now); }
+
+		//schedules handle to expire lifetime seconds from now, returns the absolute expiry time
+		//expiry is rounded up to a whole tick and is never earlier than the next tick
+		float Add(const Handle& handle, float lifetime) {
+			uint64_t expiry = static_cast<uint64_t>(std::ceil((now + lifetime) / tickLength));
+			if (expiry <= tick) expiry = tick + 1;
+			uint32_t node;
+			if (freeNodes != NoNode) {
+				node = freeNodes;
+				freeNodes = nodes[node].next;
+				nodes[node].handle = handle;
+				nodes[node].expiry = expiry;
+			}
+			else {
+				node = static_cast<uint32_t>(nodes.size());
+				nodes.push_back(Node{ handle, expiry, NoNode });
+			}
+			Insert(node);
+			count++;
+			return static_cast<float>(expiry * tickLength);
+		}
+
+		//moves the clock forward and appends every handle that expired to expired
+		void Advance(float deltaTime, std::vector<Handle>& expired) {
+			now += deltaTime;
+			const uint64_t target = static_cast<uint64_t>(now / tickLength);
+			while (tick < target) Step(expired);
+		}
+
+		//1 at birth down to 0 at death, worked out from the clock so nothing ticks per item
+		float LifeRatio(float birth, float death) const {
+			float span = death - birth;
+			if (span <= 0.0f) return 0.0f;
+			float ratio = (death - Now()) / span;
+			return ratio < 0.0f ? 0.0f : (ratio > 1.0f ? 1.0f : ratio);
+		}
+
+		size_t Size() const { return count; }
+
+	private:
+		struct Node {
+			Handle handle;
+			uint64_t expiry;
+			uint32_t next; //next node in the same bucket or the free list
+		};
+		static const uint32_t NoNode = 0xFFFFFFFFu;
+
+		static const int Level0Bits = 8;
+		static const int LevelBits = 6;
+		static const uint64_t Level0Mask = (1 << Level0Bits) - 1;
+		static const uint64_t LevelMask = (1 << LevelBits) - 1;
+		static const int Level1Shift = Level0Bits;
+		static const int Level2Shift = Level0Bits + LevelBits;
+		static const int OverflowShift = Level0Bits + 2 * LevelBits;
+
+		double tickLength;
+		double now = 0.0;
+		uint64_t tick = 0;
+		size_t count = 0;
+
+		std::vector<Node> nodes;
+		uint32_t freeNodes = NoNode;
+
+		//bucket heads
+		uint32_t level0[1 << Level0Bits];
+		uint32_t level1[1 << LevelBits];
+		uint32_t level2[1 << LevelBits];
+		uint32_t overflow = NoNode;
+
+		static void Push(uint32_t& bucket, std::vector<Node>& nodes, uint32_t node) {
+			nodes[node].next = bucket;
+			bucket = node;
+		}
+
+		//an entry goes in the finest level whose current block it shares with the clock
+		void Insert(uint32_t node) {
+			const uint64_t e = nodes[node].expiry;
+			if ((e >> Level1Shift) == (tick >> Level1Shift)) Push(level0[e & Level0Mask], nodes, node);
+			else if ((e >> Level2Shift) == (tick >> Level2Shift)) Push(level1[(e >> Level1Shift) & LevelMask], nodes, node);
+			else if ((e >> OverflowShift) == (tick >> OverflowShift)) Push(level2[(e >> Level2Shift) & LevelMask], nodes, node);
+			else Push(overflow, nodes, node);
+		}
+
+		//unhooks the whole bucket first, entries may land back in a bucket of the same level
+		void Cascade(uint32_t& bucket) {
+			uint32_t node = bucket;
+			bucket = NoNode;
+			while (node != NoNode) {
+				uint32_t next = nodes[node].next;
+				Insert(node);
+				node = next;
+			}
+		}
+
+		void Step(std::vector<Handle>& expired) {
+			tick++;
+			//entering a new block, pull the coarser buckets for it down, outermost first
+			if ((tick & Level0Mask) == 0) {
+				const uint64_t index1 = (tick >> Level1Shift) & LevelMask;
+				if (index1 == 0) {
+					const uint64_t index2 = (tick >> Level2Shift) & LevelMask;
+					if (index2 == 0) Cascade(overflow);
+					Cascade(level2[index2]);
+				}
+				Cascade(level1[index1]);
+			}
+
+			uint32_t& due = level0[tick & Level0Mask];
+			uint32_t node = due;
+			due = NoNode;
+			while (node != NoNode) {
+				uint32_t next = nodes[node].next;
+				expired.push_back(nodes[node].handle);
+				nodes[node].next = freeNodes;
+				freeNodes = node;
+				count--;
+				node = next;
+			}
+		}
+	};
+}
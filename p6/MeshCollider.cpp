@@ -0,0 +1,337 @@
+#include "MeshCollider.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace Physics {
+	namespace {
+		const int BinCount = 12;
+		const size_t MaxLeafTriangles = 4;
+		//keeps the query stack bounded, anything deeper becomes a leaf
+		const int MaxDepth = 48;
+		//relative cost of visiting a node against testing one triangle
+		const float TraversalCost = 1.0f;
+		const float TriangleCost = 1.0f;
+		//below this many particles a batch is not worth splitting
+		const size_t MinParticlesPerChunk = 512;
+		//sweeps stop once the gap is this small or after this many advances
+		const float SweepTolerance = 1e-3f;
+		const int MaxSweepIterations = 32;
+
+		struct Bounds {
+			glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+			glm::vec3 max = glm::vec3(std::numeric_limits<float>::lowest());
+
+			void Grow(const glm::vec3& point) {
+				min = glm::min(min, point);
+				max = glm::max(max, point);
+			}
+			void Grow(const glm::vec3& low, const glm::vec3& high) {
+				min = glm::min(min, low);
+				max = glm::max(max, high);
+			}
+			float Area() const {
+				glm::vec3 size = max - min;
+				if (size.x < 0.0f) return 0.0f;
+				return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+			}
+		};
+
+		//Ericson, Real-Time Collision Detection 5.1.5
+		glm::vec3 ClosestPointOnTriangle(const glm::vec3& p, const glm::vec3& a, const glm::vec3& ab, const glm::vec3& ac) {
+			glm::vec3 ap = p - a;
+			float d1 = glm::dot(ab, ap);
+			float d2 = glm::dot(ac, ap);
+			if (d1 <= 0.0f && d2 <= 0.0f) return a;
+
+			glm::vec3 bp = ap - ab;
+			float d3 = glm::dot(ab, bp);
+			float d4 = glm::dot(ac, bp);
+			if (d3 >= 0.0f && d4 <= d3) return a + ab;
+
+			float vc = d1 * d4 - d3 * d2;
+			if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) return a + ab * (d1 / (d1 - d3));
+
+			glm::vec3 cp = ap - ac;
+			float d5 = glm::dot(ab, cp);
+			float d6 = glm::dot(ac, cp);
+			if (d6 >= 0.0f && d5 <= d6) return a + ac;
+
+			float vb = d5 * d2 - d1 * d6;
+			if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) return a + ac * (d2 / (d2 - d6));
+
+			float va = d3 * d6 - d5 * d4;
+			if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) {
+				return a + ab + (ac - ab) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+			}
+
+			float denom = 1.0f / (va + vb + vc);
+			return a + ab * (vb * denom) + ac * (vc * denom);
+		}
+
+		float DistanceSquaredToBox(const glm::vec3& p, const glm::vec3& min, const glm::vec3& max) {
+			glm::vec3 d = glm::max(glm::max(min - p, p - max), glm::vec3(0.0f));
+			return glm::dot(d, d);
+		}
+	}
+
+	MeshCollider::MeshCollider(const std::vector<float>& vertices, const std::vector<unsigned int>& indices) {
+		const size_t triangleCount = indices.size() / 3;
+		std::vector<BuildTriangle> build;
+		build.reserve(triangleCount);
+		for (size_t t = 0; t < triangleCount; t++) {
+			glm::vec3 v[3];
+			for (int k = 0; k < 3; k++) {
+				size_t i = indices[t * 3 + k] * 3;
+				v[k] = glm::vec3(vertices[i], vertices[i + 1], vertices[i + 2]);
+			}
+			BuildTriangle entry;
+			entry.min = glm::min(v[0], glm::min(v[1], v[2]));
+			entry.max = glm::max(v[0], glm::max(v[1], v[2]));
+			entry.centroid = (v[0] + v[1] + v[2]) / 3.0f;
+			entry.source = static_cast<uint32_t>(t);
+			build.push_back(entry);
+		}
+		if (build.empty()) return;
+
+		//a binary tree has at most 2n - 1 nodes
+		nodes.reserve(build.size() * 2);
+		Build(build, 0, build.size(), 0);
+
+		//copy triangles out in leaf order so a leaf reads one contiguous run
+		triangles.reserve(build.size());
+		for (const BuildTriangle& entry : build) {
+			glm::vec3 v[3];
+			for (int k = 0; k < 3; k++) {
+				size_t i = indices[entry.source * 3 + k] * 3;
+				v[k] = glm::vec3(vertices[i], vertices[i + 1], vertices[i + 2]);
+			}
+			triangles.push_back(Triangle{ v[0], v[1] - v[0], v[2] - v[0] });
+		}
+		nodes.shrink_to_fit();
+	}
+
+	uint32_t MeshCollider::Build(std::vector<BuildTriangle>& build, size_t begin, size_t end, int depth) {
+		const uint32_t nodeIndex = static_cast<uint32_t>(nodes.size());
+		nodes.push_back(Node());
+
+		Bounds bounds, centroidBounds;
+		for (size_t i = begin; i < end; i++) {
+			bounds.Grow(build[i].min, build[i].max);
+			centroidBounds.Grow(build[i].centroid);
+		}
+		nodes[nodeIndex].min = bounds.min;
+		nodes[nodeIndex].max = bounds.max;
+
+		const size_t count = end - begin;
+		auto makeLeaf = [&]() {
+			nodes[nodeIndex].index = static_cast<uint32_t>(begin);
+			nodes[nodeIndex].count = static_cast<uint32_t>(count);
+			return nodeIndex;
+		};
+		if (count <= MaxLeafTriangles || depth >= MaxDepth) return makeLeaf();
+
+		//binned SAH, every axis, cost = traversal + (area left * count left + area right * count right) / area
+		float bestCost = std::numeric_limits<float>::max();
+		int bestAxis = -1;
+		int bestSplit = 0;
+		const glm::vec3 extent = centroidBounds.max - centroidBounds.min;
+		for (int axis = 0; axis < 3; axis++) {
+			if (extent[axis] <= 0.0f) continue;
+			Bounds binBounds[BinCount];
+			size_t binCount[BinCount] = { 0 };
+			const float scale = BinCount / extent[axis];
+			for (size_t i = begin; i < end; i++) {
+				int bin = std::min(BinCount - 1, static_cast<int>((build[i].centroid[axis] - centroidBounds.min[axis]) * scale));
+				binCount[bin]++;
+				binBounds[bin].Grow(build[i].min, build[i].max);
+			}
+
+			//sweep from the right so each split knows its right side in one pass
+			float rightArea[BinCount - 1];
+			size_t rightCount[BinCount - 1];
+			Bounds right;
+			size_t rightTotal = 0;
+			for (int split = BinCount - 1; split > 0; split--) {
+				right.Grow(binBounds[split].min, binBounds[split].max);
+				rightTotal += binCount[split];
+				rightArea[split - 1] = right.Area();
+				rightCount[split - 1] = rightTotal;
+			}
+
+			Bounds left;
+			size_t leftTotal = 0;
+			for (int split = 0; split < BinCount - 1; split++) {
+				left.Grow(binBounds[split].min, binBounds[split].max);
+				leftTotal += binCount[split];
+				if (leftTotal == 0 || rightCount[split] == 0) continue;
+				float cost = left.Area() * leftTotal + rightArea[split] * rightCount[split];
+				if (cost < bestCost) {
+					bestCost = cost;
+					bestAxis = axis;
+					bestSplit = split;
+				}
+			}
+		}
+
+		const float parentArea = bounds.Area();
+		const float leafCost = TriangleCost * count;
+		const float splitCost = parentArea > 0.0f ? TraversalCost + TriangleCost * bestCost / parentArea : leafCost;
+		if (bestAxis < 0 || splitCost >= leafCost) {
+			//no useful split, only stop here if the leaf is not absurdly big
+			if (bestAxis < 0 || count <= MaxLeafTriangles * 4) return makeLeaf();
+		}
+
+		size_t middle;
+		if (bestAxis >= 0) {
+			const float scale = BinCount / extent[bestAxis];
+			const float minimum = centroidBounds.min[bestAxis];
+			auto it = std::partition(build.begin() + begin, build.begin() + end, [&](const BuildTriangle& entry) {
+				int bin = std::min(BinCount - 1, static_cast<int>((entry.centroid[bestAxis] - minimum) * scale));
+				return bin <= bestSplit;
+			});
+			middle = static_cast<size_t>(it - build.begin());
+		}
+		else {
+			middle = begin + count / 2;
+		}
+
+		//left child is always nodeIndex + 1, only the right one needs storing
+		Build(build, begin, middle, depth + 1);
+		const uint32_t rightChild = Build(build, middle, end, depth + 1);
+		nodes[nodeIndex].index = rightChild;
+		nodes[nodeIndex].count = 0;
+		return nodeIndex;
+	}
+
+	bool MeshCollider::Query(const glm::vec3& center, float radius, Hit& hit) const {
+		hit.distanceSquared = radius * radius;
+		bool found = false;
+
+		//one pending sibling per level plus the root
+		uint32_t stack[MaxDepth + 2];
+		int top = 0;
+		stack[top++] = 0;
+		while (top > 0) {
+			const Node& node = nodes[stack[--top]];
+			//skips anything farther than the best triangle so far, not just farther than the radius
+			if (DistanceSquaredToBox(center, node.min, node.max) > hit.distanceSquared) continue;
+
+			if (node.count > 0) {
+				for (uint32_t t = node.index; t < node.index + node.count; t++) {
+					const Triangle& triangle = triangles[t];
+					glm::vec3 point = ClosestPointOnTriangle(center, triangle.a, triangle.ab, triangle.ac);
+					glm::vec3 offset = center - point;
+					float distanceSquared = glm::dot(offset, offset);
+					if (distanceSquared < hit.distanceSquared) {
+						hit.distanceSquared = distanceSquared;
+						hit.point = point;
+						hit.triangle = t;
+						found = true;
+					}
+				}
+				continue;
+			}
+
+			//nearer child last so it is popped first and tightens the bound sooner
+			const uint32_t left = static_cast<uint32_t>(&node - nodes.data()) + 1;
+			const uint32_t right = node.index;
+			float leftDistance = DistanceSquaredToBox(center, nodes[left].min, nodes[left].max);
+			float rightDistance = DistanceSquaredToBox(center, nodes[right].min, nodes[right].max);
+			if (leftDistance < rightDistance) {
+				stack[top++] = right;
+				stack[top++] = left;
+			}
+			else {
+				stack[top++] = left;
+				stack[top++] = right;
+			}
+		}
+		return found;
+	}
+
+	glm::vec3 MeshCollider::HitNormal(const glm::vec3& center, const Hit& hit, const glm::vec3& motion) const {
+		float distance = std::sqrt(hit.distanceSquared);
+		if (distance > 1e-5f) return (center - hit.point) / distance;
+
+		//center on the surface, fall back to the face normal facing against the motion
+		const Triangle& triangle = triangles[hit.triangle];
+		glm::vec3 normal = glm::normalize(glm::cross(triangle.ab, triangle.ac));
+		if (glm::dot(normal, motion) > 0.0f) normal = -normal;
+		return normal;
+	}
+
+	bool MeshCollider::Sweep(const glm::vec3& from, const glm::vec3& to, float radius, float& time, glm::vec3& normal) const {
+		if (nodes.empty()) return false;
+		const glm::vec3 motion = to - from;
+		const float length = glm::length(motion);
+		if (length <= 0.0f) return false;
+
+		//the whole path misses the mesh bounds
+		glm::vec3 pathMin = glm::min(from, to) - glm::vec3(radius);
+		glm::vec3 pathMax = glm::max(from, to) + glm::vec3(radius);
+		if (glm::any(glm::lessThan(pathMax, nodes[0].min)) || glm::any(glm::greaterThan(pathMin, nodes[0].max))) {
+			return false;
+		}
+
+		//conservative advancement, the nearest triangle is gap away so the sphere can move
+		//at least that far along any direction without touching anything
+		float t = 0.0f;
+		for (int i = 0; i < MaxSweepIterations; i++) {
+			glm::vec3 center = from + motion * t;
+			Hit hit;
+			if (!Query(center, radius + length * (1.0f - t), hit)) return false;
+
+			float gap = std::sqrt(hit.distanceSquared) - radius;
+			if (gap <= SweepTolerance) {
+				glm::vec3 hitNormal = HitNormal(center, hit, motion);
+				if (glm::dot(hitNormal, motion) >= 0.0f) return false;
+				time = t;
+				normal = hitNormal;
+				return true;
+			}
+			t += gap / length;
+			if (t >= 1.0f) return false;
+		}
+		return false;
+	}
+
+	size_t MeshCollider::Collide(PhysicsParticle* const* particles, size_t count, FrameArena& scratch,
+		ArenaVector<ParticleContact>& contacts) const {
+		if (nodes.empty() || count == 0) return 0;
+
+		//every particle gets a slot so the parallel pass never has to append
+		Hit* hits = scratch.AllocateArray<Hit>(count);
+		uint8_t* touching = scratch.AllocateArray<uint8_t>(count);
+		auto body = [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) {
+				const PhysicsParticle* particle = particles[i];
+				glm::vec3 center(particle->Position.x, particle->Position.y, particle->Position.z);
+				touching[i] = Query(center, particle->radius, hits[i]) ? 1 : 0;
+			}
+		};
+		if (count < MinParticlesPerChunk * 2) body(0, count);
+		else ThreadPool::Shared().ParallelFor(count, MinParticlesPerChunk, body);
+
+		const size_t before = contacts.size();
+		for (size_t i = 0; i < count; i++) {
+			if (!touching[i]) continue;
+			const Hit& hit = hits[i];
+			PhysicsParticle* particle = particles[i];
+			glm::vec3 center(particle->Position.x, particle->Position.y, particle->Position.z);
+			float distance = std::sqrt(hit.distanceSquared);
+			glm::vec3 velocity(particle->Velocity.x, particle->Velocity.y, particle->Velocity.z);
+			glm::vec3 normal = HitNormal(center, hit, velocity);
+
+			ParticleContact contact;
+			contact.particles[0] = particle;
+			contact.particles[1] = nullptr;
+			contact.restitution = restitution;
+			contact.contactNormal = MyVector(normal.x, normal.y, normal.z);
+			contact.depth = particle->radius - distance;
+			contacts.push_back(contact);
+		}
+		return contacts.size() - before;
+	}
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <glm/glm.hpp>
+#include "PhysicsParticle.h"
+#include "ParticleContact.h"
+#include "FrameArena.h"
+
+namespace Physics {
+	//static triangle mesh particles collide with, in world space and never moved after building
+	//triangles sit in a BVH split with the surface area heuristic, nodes are stored depth first
+	//so a left child always sits right after its parent and a query mostly walks memory forwards
+	class MeshCollider {
+	public:
+		//vertices are packed xyz, indices are triangles
+		MeshCollider(const std::vector<float>& vertices, const std::vector<unsigned int>& indices);
+
+		//tests every particle's sphere against the mesh and appends one contact per touching
+		//particle, for its deepest triangle, the per particle results live in scratch
+		//runs on the shared pool for big batches, returns how many contacts were added
+		size_t Collide(PhysicsParticle* const* particles, size_t count, FrameArena& scratch,
+			ArenaVector<ParticleContact>& contacts) const;
+
+		//moves a sphere from from to to and finds the first time in [0, 1] it touches the mesh,
+		//steps forward by the gap to the nearest triangle each time so it can not skip through
+		//spheres that start touching and move away are ignored, the discrete pass has them
+		bool Sweep(const glm::vec3& from, const glm::vec3& to, float radius, float& time, glm::vec3& normal) const;
+
+		//bounciness given to generated contacts
+		void SetRestitution(float value) { restitution = value; }
+		float GetRestitution() const { return restitution; }
+
+		size_t GetTriangleCount() const { return triangles.size(); }
+		size_t GetNodeCount() const { return nodes.size(); }
+		glm::vec3 GetBoundsMin() const { return nodes.empty() ? glm::vec3(0.0f) : nodes[0].min; }
+		glm::vec3 GetBoundsMax() const { return nodes.empty() ? glm::vec3(0.0f) : nodes[0].max; }
+
+	private:
+		//32 bytes, two per cache line
+		struct Node {
+			glm::vec3 min;
+			uint32_t index; //right child for inner nodes, first triangle for leaves
+			glm::vec3 max;
+			uint32_t count; //triangles in a leaf, 0 for inner nodes
+		};
+
+		//a plus the two edges, the form the closest point test wants
+		struct Triangle {
+			glm::vec3 a;
+			glm::vec3 ab;
+			glm::vec3 ac;
+		};
+
+		//closest hit of one sphere, distance is squared
+		struct Hit {
+			float distanceSquared;
+			glm::vec3 point;
+			uint32_t triangle;
+		};
+
+		//triangle data while building, centroids and bounds get binned along the split axis
+		struct BuildTriangle {
+			glm::vec3 min;
+			glm::vec3 max;
+			glm::vec3 centroid;
+			uint32_t source;
+		};
+
+		std::vector<Node> nodes;
+		std::vector<Triangle> triangles; //in leaf order
+		float restitution = 0.5f;
+
+		uint32_t Build(std::vector<BuildTriangle>& build, size_t begin, size_t end, int depth);
+		bool Query(const glm::vec3& center, float radius, Hit& hit) const;
+		//points from the hit towards the center, motion picks the face side when the center is on it
+		glm::vec3 HitNormal(const glm::vec3& center, const Hit& hit, const glm::vec3& motion) const;
+	};
+}
@@ -0,0 +1,430 @@
+#include "NBodyGravity.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "ThreadPool.h"
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#include <emmintrin.h>
+#define NBODY_USE_SSE
+#endif
+
+namespace Physics {
+	namespace {
+		//fewer bodies than this are not worth handing to the pool
+		const size_t MinBodiesPerChunk = 512;
+		const size_t MinLeavesPerChunk = 64;
+
+		//spreads the low 10 bits out to every third bit
+		uint32_t SpreadBits(uint32_t v) {
+			v &= 0x3ff;
+			v = (v | (v << 16)) & 0x030000ff;
+			v = (v | (v << 8)) & 0x0300f00f;
+			v = (v | (v << 4)) & 0x030c30c3;
+			v = (v | (v << 2)) & 0x09249249;
+			return v;
+		}
+
+		//undoes SpreadBits
+		uint32_t CompactBits(uint32_t v) {
+			v &= 0x09249249;
+			v = (v ^ (v >> 2)) & 0x030c30c3;
+			v = (v ^ (v >> 4)) & 0x0300f00f;
+			v = (v ^ (v >> 8)) & 0x030000ff;
+			v = (v ^ (v >> 16)) & 0x000003ff;
+			return v;
+		}
+
+		uint32_t Quantize(float value, float min, float scale) {
+			float q = (value - min) * scale;
+			if (!(q > 0.0f)) return 0;
+			if (q >= 1023.0f) return 1023;
+			return static_cast<uint32_t>(q);
+		}
+	}
+
+	void NBodyGravity::Apply(PhysicsParticle* const* particles, size_t count, float time) {
+		//bodies with mass and the cube around them
+		if (keys.size() < count) {
+			keys.resize(count);
+			keysScratch.resize(count);
+		}
+		size_t bodyCount = 0;
+		float min[3] = { 0, 0, 0 }, max[3] = { 0, 0, 0 };
+		for (size_t i = 0; i < count; i++) {
+			const PhysicsParticle* p = particles[i];
+			if (p->mass <= 0) continue;
+			const float position[3] = { p->Position.x, p->Position.y, p->Position.z };
+			for (int axis = 0; axis < 3; axis++) {
+				if (bodyCount == 0 || position[axis] < min[axis]) min[axis] = position[axis];
+				if (bodyCount == 0 || position[axis] > max[axis]) max[axis] = position[axis];
+			}
+			keys[bodyCount++] = i;
+		}
+		nodeCount = 0;
+		if (bodyCount < 2) return;
+
+		//a little over the biggest extent so the far corner still quantizes inside
+		float width = std::max(max[0] - min[0], std::max(max[1] - min[1], max[2] - min[2]));
+		width = std::max(width * 1.0001f, 1e-6f);
+		const float scale = 1024.0f / width;
+		std::memcpy(treeMin, min, sizeof(treeMin));
+		cellWidth = width / 1024.0f;
+		const float inverseTheta2 = theta > 0.0f ? 1.0f / (theta * theta) : 3.4e38f;
+		for (int level = 0; level <= MaxLevel; level++) {
+			float nodeWidth = std::ldexp(width, -level);
+			levelOpen[level] = theta > 0.0f ? nodeWidth * nodeWidth * inverseTheta2 : 3.4e38f;
+		}
+
+		ThreadPool& pool = ThreadPool::Shared();
+		pool.ParallelFor(bodyCount, MinBodiesPerChunk, [&](size_t begin, size_t end) {
+			for (size_t k = begin; k < end; k++) {
+				const MyVector& position = particles[keys[k]]->Position;
+				uint32_t code = SpreadBits(Quantize(position.x, min[0], scale))
+					| (SpreadBits(Quantize(position.y, min[1], scale)) << 1)
+					| (SpreadBits(Quantize(position.z, min[2], scale)) << 2);
+				keys[k] |= static_cast<uint64_t>(code) << 32;
+			}
+		});
+		Sort(bodyCount);
+
+		if (bodies.size() < bodyCount) {
+			bodies.resize(bodyCount);
+			codes.resize(bodyCount);
+			bodyX.resize(bodyCount);
+			bodyY.resize(bodyCount);
+			bodyZ.resize(bodyCount);
+			bodyMass.resize(bodyCount);
+		}
+		pool.ParallelFor(bodyCount, MinBodiesPerChunk, [&](size_t begin, size_t end) {
+			for (size_t k = begin; k < end; k++) {
+				PhysicsParticle* p = particles[keys[k] & 0xffffffffu];
+				bodies[k] = p;
+				codes[k] = static_cast<uint32_t>(keys[k] >> 32);
+				bodyX[k] = p->Position.x;
+				bodyY[k] = p->Position.y;
+				bodyZ[k] = p->Position.z;
+				bodyMass[k] = p->mass;
+			}
+		});
+
+		//top of the tree is laid out serially, the subtrees under it are counted, placed and
+		//then built in parallel, each straight into its own slice of the node arrays
+		plan.clear();
+		Plan(0, static_cast<uint32_t>(bodyCount), 0);
+		pool.ParallelFor(plan.size(), 1, [&](size_t begin, size_t end) {
+			for (size_t k = begin; k < end; k++) {
+				PlanEntry& entry = plan[k];
+				entry.nodes = entry.subtree ? CountNodes(entry.begin, entry.end, entry.level) : 1;
+			}
+		});
+		uint32_t cursor = 0;
+		for (PlanEntry& entry : plan) {
+			entry.node = cursor;
+			cursor += entry.nodes;
+		}
+		nodeCount = cursor;
+		if (nodeX.size() < nodeCount) {
+			nodeX.resize(nodeCount);
+			nodeY.resize(nodeCount);
+			nodeZ.resize(nodeCount);
+			nodeMass.resize(nodeCount);
+			nodeOpen.resize(nodeCount);
+			nodeNext.resize(nodeCount);
+			nodeFirst.resize(nodeCount);
+			nodeBodies.resize(nodeCount);
+		}
+
+		//a top node's subtree ends where the next entry at its level or above starts
+		uint32_t open[MaxLevel + 1];
+		int openCount = 0;
+		for (const PlanEntry& entry : plan) {
+			while (openCount > 0 && plan[open[openCount - 1]].level >= entry.level) {
+				nodeNext[plan[open[--openCount]].node] = entry.node;
+			}
+			if (entry.subtree) continue;
+			open[openCount++] = static_cast<uint32_t>(&entry - plan.data());
+			nodeFirst[entry.node] = entry.begin;
+			nodeBodies[entry.node] = 0;
+			nodeOpen[entry.node] = levelOpen[entry.level];
+		}
+		while (openCount > 0) nodeNext[plan[open[--openCount]].node] = cursor;
+		pool.ParallelFor(plan.size(), 1, [&](size_t begin, size_t end) {
+			for (size_t k = begin; k < end; k++) {
+				const PlanEntry& entry = plan[k];
+				if (entry.subtree) Build(entry.begin, entry.end, entry.level, entry.node);
+			}
+		});
+		//children come after their parent, so going backwards every child is done first
+		for (size_t k = plan.size(); k-- > 0;) {
+			if (!plan[k].subtree) Aggregate(plan[k].node);
+		}
+
+		//bodies are walked a leaf at a time, neighbours in a leaf share one list of what pulls on them
+		leaves.clear();
+		for (uint32_t node = 0; node < nodeCount; node++) {
+			if (nodeBodies[node]) leaves.push_back(node);
+		}
+		pool.ParallelFor(leaves.size(), MinLeavesPerChunk, [&](size_t begin, size_t end) {
+			for (size_t k = begin; k < end; k++) {
+				const uint32_t first = nodeFirst[leaves[k]];
+				const uint32_t last = first + nodeBodies[leaves[k]];
+				for (uint32_t group = first; group < last; group += MaxGroup) {
+					Walk(group, std::min(group + MaxGroup, last));
+				}
+			}
+		});
+	}
+
+	void NBodyGravity::Sort(size_t count) {
+		//lsd radix on the 30 bit morton code, 10 bits a pass
+		uint64_t* from = keys.data();
+		uint64_t* to = keysScratch.data();
+		for (int shift = 32; shift < 62; shift += 10) {
+			uint32_t offsets[1024];
+			std::memset(offsets, 0, sizeof(offsets));
+			for (size_t i = 0; i < count; i++) offsets[(from[i] >> shift) & 1023]++;
+			uint32_t sum = 0;
+			for (int b = 0; b < 1024; b++) {
+				uint32_t n = offsets[b];
+				offsets[b] = sum;
+				sum += n;
+			}
+			for (size_t i = 0; i < count; i++) to[offsets[(from[i] >> shift) & 1023]++] = from[i];
+			std::swap(from, to);
+		}
+		//three passes leave the result in the scratch array
+		if (from != keys.data()) std::memcpy(keys.data(), from, sizeof(uint64_t) * count);
+	}
+
+	void NBodyGravity::Split(uint32_t begin, uint32_t end, int level, uint32_t octantEnd[8]) const {
+		//everything in the range shares the bits above this level, so the octant only grows
+		const int shift = 3 * (MaxLevel - 1 - level);
+		const uint32_t* first = codes.data() + begin;
+		const uint32_t* last = codes.data() + end;
+		for (uint32_t octant = 0; octant < 8; octant++) {
+			first = std::partition_point(first, last, [&](uint32_t code) { return ((code >> shift) & 7) <= octant; });
+			octantEnd[octant] = static_cast<uint32_t>(first - codes.data());
+		}
+	}
+
+	void NBodyGravity::Plan(uint32_t begin, uint32_t end, int level) {
+		PlanEntry entry;
+		entry.begin = begin;
+		entry.end = end;
+		entry.level = level;
+		entry.subtree = end - begin <= SubtreeBodies || IsLeaf(begin, end, level);
+		entry.node = 0;
+		entry.nodes = 0;
+		plan.push_back(entry);
+		if (entry.subtree) return;
+
+		uint32_t octantEnd[8];
+		Split(begin, end, level, octantEnd);
+		for (int octant = 0; octant < 8; octant++) {
+			if (octantEnd[octant] > begin) Plan(begin, octantEnd[octant], level + 1);
+			begin = octantEnd[octant];
+		}
+	}
+
+	uint32_t NBodyGravity::CountNodes(uint32_t begin, uint32_t end, int level) const {
+		if (IsLeaf(begin, end, level)) return 1;
+		uint32_t octantEnd[8];
+		Split(begin, end, level, octantEnd);
+		uint32_t nodes = 1;
+		for (int octant = 0; octant < 8; octant++) {
+			if (octantEnd[octant] > begin) nodes += CountNodes(begin, octantEnd[octant], level + 1);
+			begin = octantEnd[octant];
+		}
+		return nodes;
+	}
+
+	uint32_t NBodyGravity::Build(uint32_t begin, uint32_t end, int level, uint32_t node) {
+		nodeOpen[node] = levelOpen[level];
+		nodeFirst[node] = begin;
+		if (IsLeaf(begin, end, level)) {
+			float mass = 0, x = 0, y = 0, z = 0;
+			for (uint32_t i = begin; i < end; i++) {
+				mass += bodyMass[i];
+				x += bodyX[i] * bodyMass[i];
+				y += bodyY[i] * bodyMass[i];
+				z += bodyZ[i] * bodyMass[i];
+			}
+			nodeMass[node] = mass;
+			nodeX[node] = x / mass;
+			nodeY[node] = y / mass;
+			nodeZ[node] = z / mass;
+			nodeBodies[node] = end - begin;
+			nodeNext[node] = node + 1;
+			return node + 1;
+		}
+
+		uint32_t octantEnd[8];
+		Split(begin, end, level, octantEnd);
+		uint32_t child = node + 1;
+		for (int octant = 0; octant < 8; octant++) {
+			if (octantEnd[octant] > begin) child = Build(begin, octantEnd[octant], level + 1, child);
+			begin = octantEnd[octant];
+		}
+		nodeBodies[node] = 0;
+		nodeNext[node] = child;
+		Aggregate(node);
+		return child;
+	}
+
+	void NBodyGravity::Aggregate(uint32_t node) {
+		float mass = 0, x = 0, y = 0, z = 0;
+		for (uint32_t child = node + 1; child < nodeNext[node]; child = nodeNext[child]) {
+			mass += nodeMass[child];
+			x += nodeX[child] * nodeMass[child];
+			y += nodeY[child] * nodeMass[child];
+			z += nodeZ[child] * nodeMass[child];
+		}
+		nodeMass[node] = mass;
+		nodeX[node] = x / mass;
+		nodeY[node] = y / mass;
+		nodeZ[node] = z / mass;
+	}
+
+	bool NBodyGravity::CellTouches(uint32_t body, const float min[3], const float max[3]) const {
+		//the deepest cell is all of the morton code, so it comes straight back out of it
+		const uint32_t code = codes[body];
+		const uint32_t cell[3] = { CompactBits(code), CompactBits(code >> 1), CompactBits(code >> 2) };
+		//padded a little, rounding may quantize a body just over the cell's edge into it
+		const float pad = cellWidth * 0.01f;
+		for (int axis = 0; axis < 3; axis++) {
+			float low = treeMin[axis] + cell[axis] * cellWidth;
+			if (max[axis] < low - pad || min[axis] > low + cellWidth + pad) return false;
+		}
+		return true;
+	}
+
+	void NBodyGravity::Walk(uint32_t begin, uint32_t end) const {
+		//box around the group, a node is used whole only if it is far enough from all of it
+		float min[3] = { bodyX[begin], bodyY[begin], bodyZ[begin] };
+		float max[3] = { min[0], min[1], min[2] };
+		for (uint32_t i = begin + 1; i < end; i++) {
+			min[0] = std::min(min[0], bodyX[i]); max[0] = std::max(max[0], bodyX[i]);
+			min[1] = std::min(min[1], bodyY[i]); max[1] = std::max(max[1], bodyY[i]);
+			min[2] = std::min(min[2], bodyZ[i]); max[2] = std::max(max[2], bodyZ[i]);
+		}
+
+		InteractionList list;
+		list.count = 0;
+		float ax[MaxGroup], ay[MaxGroup], az[MaxGroup];
+		for (uint32_t i = 0; i < end - begin; i++) ax[i] = ay[i] = az[i] = 0.0f;
+		const float soft2 = softening * softening;
+		auto push = [&](float x, float y, float z, float mass) {
+			if (list.count == InteractionList::Capacity) {
+				Interact(begin, end, list, soft2, ax, ay, az);
+				list.count = 0;
+			}
+			list.x[list.count] = x;
+			list.y[list.count] = y;
+			list.z[list.count] = z;
+			list.mass[list.count] = mass;
+			list.count++;
+		};
+
+		//stackless, accepting or finishing a node jumps over its subtree, opening it steps
+		//into its first child
+		uint32_t node = 0;
+		while (node < nodeCount) {
+			const float cx = nodeX[node], cy = nodeY[node], cz = nodeZ[node];
+			float dx = std::max(0.0f, std::max(min[0] - cx, cx - max[0]));
+			float dy = std::max(0.0f, std::max(min[1] - cy, cy - max[1]));
+			float dz = std::max(0.0f, std::max(min[2] - cz, cz - max[2]));
+			const uint32_t leafBodies = nodeBodies[node];
+			//only the deepest leaves hold more than LeafSize, bodies piled up on nearly the same
+			//spot, a pile clear of the group pulls as one body instead of body by body
+			//theta 0 stays exact and a pile the group is in or touches is summed body by body,
+			//otherwise the group would be pulled toward a center that includes itself
+			if (nodeOpen[node] < dx * dx + dy * dy + dz * dz
+				|| (leafBodies > LeafSize && theta > 0.0f && begin - nodeFirst[node] >= leafBodies
+					&& !CellTouches(nodeFirst[node], min, max))) {
+				push(cx, cy, cz, nodeMass[node]);
+				node = nodeNext[node];
+			}
+			else if (leafBodies) {
+				const uint32_t first = nodeFirst[node];
+				for (uint32_t i = first; i < first + leafBodies; i++) push(bodyX[i], bodyY[i], bodyZ[i], bodyMass[i]);
+				node = nodeNext[node];
+			}
+			else {
+				node++;
+			}
+		}
+		Interact(begin, end, list, soft2, ax, ay, az);
+
+		const float g = gravitationalConstant;
+		for (uint32_t i = begin; i < end; i++) {
+			const float m = bodyMass[i] * g;
+			const uint32_t k = i - begin;
+			bodies[i]->AddForce(MyVector(ax[k] * m, ay[k] * m, az[k] * m));
+		}
+	}
+
+	void NBodyGravity::Interact(uint32_t begin, uint32_t end, InteractionList& list, float soft2,
+		float* ax, float* ay, float* az) const {
+		//a body finds itself in the list too, zero distance is skipped so it adds nothing
+#ifdef NBODY_USE_SSE
+		//pad to whole registers with massless entries
+		while (list.count % 4) {
+			list.x[list.count] = list.y[list.count] = list.z[list.count] = 0.0f;
+			list.mass[list.count] = 0.0f;
+			list.count++;
+		}
+		const __m128 soft = _mm_set1_ps(soft2);
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 half = _mm_set1_ps(0.5f);
+		const __m128 threeHalves = _mm_set1_ps(1.5f);
+		for (uint32_t i = begin; i < end; i++) {
+			const __m128 px = _mm_set1_ps(bodyX[i]), py = _mm_set1_ps(bodyY[i]), pz = _mm_set1_ps(bodyZ[i]);
+			__m128 sx = zero, sy = zero, sz = zero;
+			for (uint32_t j = 0; j < list.count; j += 4) {
+				__m128 dx = _mm_sub_ps(_mm_load_ps(list.x + j), px);
+				__m128 dy = _mm_sub_ps(_mm_load_ps(list.y + j), py);
+				__m128 dz = _mm_sub_ps(_mm_load_ps(list.z + j), pz);
+				__m128 r2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+				__m128 self = _mm_cmpgt_ps(r2, zero);
+				r2 = _mm_add_ps(r2, soft);
+				//estimate plus one newton step, close to full float precision for far less than a divide
+				__m128 inverse = _mm_rsqrt_ps(r2);
+				inverse = _mm_mul_ps(inverse, _mm_sub_ps(threeHalves, _mm_mul_ps(_mm_mul_ps(half, r2), _mm_mul_ps(inverse, inverse))));
+				__m128 s = _mm_mul_ps(_mm_load_ps(list.mass + j), _mm_mul_ps(inverse, _mm_mul_ps(inverse, inverse)));
+				s = _mm_and_ps(s, self);
+				sx = _mm_add_ps(sx, _mm_mul_ps(dx, s));
+				sy = _mm_add_ps(sy, _mm_mul_ps(dy, s));
+				sz = _mm_add_ps(sz, _mm_mul_ps(dz, s));
+			}
+			alignas(16) float lanes[3][4];
+			_mm_store_ps(lanes[0], sx);
+			_mm_store_ps(lanes[1], sy);
+			_mm_store_ps(lanes[2], sz);
+			const uint32_t k = i - begin;
+			ax[k] += (lanes[0][0] + lanes[0][1]) + (lanes[0][2] + lanes[0][3]);
+			ay[k] += (lanes[1][0] + lanes[1][1]) + (lanes[1][2] + lanes[1][3]);
+			az[k] += (lanes[2][0] + lanes[2][1]) + (lanes[2][2] + lanes[2][3]);
+		}
+#else
+		for (uint32_t i = begin; i < end; i++) {
+			const float px = bodyX[i], py = bodyY[i], pz = bodyZ[i];
+			float sx = 0, sy = 0, sz = 0;
+			for (uint32_t j = 0; j < list.count; j++) {
+				float dx = list.x[j] - px, dy = list.y[j] - py, dz = list.z[j] - pz;
+				float r2 = dx * dx + dy * dy + dz * dz;
+				if (r2 <= 0.0f) continue;
+				float inverse = 1.0f / std::sqrt(r2 + soft2);
+				float s = list.mass[j] * inverse * inverse * inverse;
+				sx += dx * s;
+				sy += dy * s;
+				sz += dz * s;
+			}
+			const uint32_t k = i - begin;
+			ax[k] += sx;
+			ay[k] += sy;
+			az[k] += sz;
+		}
+#endif
+	}
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "PhysicsParticle.h"
+#include "ForcePipeline.h"
+
+namespace Physics {
+	//every particle pulls on every other, G * m1 * m2 / r^2, through a Barnes-Hut octree
+	//the tree is rebuilt each step from the particles sorted along a morton curve, distant
+	//groups of bodies act as one body at their center of mass, so a step is O(n log n)
+	//the bodies of a leaf walk the tree together and share one list of what pulls on them,
+	//which is then summed four entries at a time
+	//hand it to PhysicsWorld::SetForcePipeline, it replaces the constant downward gravity
+	//particles with no mass neither pull nor get pulled
+	class NBodyGravity : public ForcePipelineBase {
+	public:
+		void Apply(PhysicsParticle* const* particles, size_t count, float time) override;
+
+		void SetGravitationalConstant(float value) { gravitationalConstant = value; }
+		float GetGravitationalConstant() const { return gravitationalConstant; }
+
+		//opening angle, a node is used whole when its width over its distance is below this
+		//0 is exact and slow, 0.5 is the usual trade, above 1 gets noticeably wrong
+		void SetTheta(float value) { theta = value < 0.0f ? 0.0f : value; }
+		float GetTheta() const { return theta; }
+
+		//added to the squared distance so close passes do not fling bodies off to infinity
+		void SetSoftening(float value) { softening = value; }
+		float GetSoftening() const { return softening; }
+
+		//nodes in the last tree, for tuning
+		size_t GetNodeCount() const { return nodeCount; }
+
+	private:
+		//bodies a leaf holds before it is split
+		static const uint32_t LeafSize = 32;
+		//10 bits per axis in the morton code, so the tree is at most this deep
+		static const int MaxLevel = 10;
+		//bodies under which a subtree is built by one thread
+		static const uint32_t SubtreeBodies = 2048;
+		//bodies walked together, a pile in one deep leaf is split into groups this big
+		static const uint32_t MaxGroup = 32;
+
+		float gravitationalConstant = 1.0f;
+		float theta = 0.5f;
+		float softening = 1.0f;
+
+		//bodies sorted along the morton curve
+		std::vector<uint64_t> keys; //morton code << 32 | particle index
+		std::vector<uint64_t> keysScratch;
+		std::vector<uint32_t> codes;
+		std::vector<float> bodyX, bodyY, bodyZ, bodyMass;
+		std::vector<PhysicsParticle*> bodies;
+
+		//nodes in depth first order, a node's children follow it and next skips its subtree
+		std::vector<float> nodeX, nodeY, nodeZ, nodeMass; //center of mass and total mass
+		std::vector<float> nodeOpen; //(width / theta)^2, used whole once the squared distance is past it
+		std::vector<uint32_t> nodeNext;
+		std::vector<uint32_t> nodeFirst; //leaves only, first body
+		std::vector<uint32_t> nodeBodies; //leaves only, how many bodies, 0 for inner nodes
+		size_t nodeCount = 0;
+
+		//top of the tree, split up serially until the pieces are small enough to hand out
+		struct PlanEntry {
+			uint32_t begin, end;
+			int level;
+			bool subtree; //built whole by one task
+			uint32_t node;
+			uint32_t nodes;
+		};
+		std::vector<PlanEntry> plan;
+		float levelOpen[MaxLevel + 1];
+		//corner of the root cube and width of the deepest cells
+		float treeMin[3] = { 0, 0, 0 };
+		float cellWidth = 0.0f;
+
+		void Sort(size_t count);
+		void Plan(uint32_t begin, uint32_t end, int level);
+		uint32_t CountNodes(uint32_t begin, uint32_t end, int level) const;
+		uint32_t Build(uint32_t begin, uint32_t end, int level, uint32_t node);
+		void Aggregate(uint32_t node);
+		//splits [begin, end) by the three morton bits of level, returns one past each octant
+		void Split(uint32_t begin, uint32_t end, int level, uint32_t octantEnd[8]) const;
+		bool IsLeaf(uint32_t begin, uint32_t end, int level) const {
+			return end - begin <= LeafSize || level >= MaxLevel;
+		}
+
+		//what pulls on a group of bodies, whole nodes and single bodies alike
+		struct InteractionList {
+			static const uint32_t Capacity = 512;
+			alignas(16) float x[Capacity];
+			alignas(16) float y[Capacity];
+			alignas(16) float z[Capacity];
+			alignas(16) float mass[Capacity];
+			uint32_t count;
+		};
+		std::vector<uint32_t> leaves;
+
+		//whether the deepest cell holding body overlaps the box min to max
+		bool CellTouches(uint32_t body, const float min[3], const float max[3]) const;
+		//walks the tree once for bodies [begin, end) of one leaf and adds their forces
+		void Walk(uint32_t begin, uint32_t end) const;
+		//sums the list's pull on each body into a, 4 list entries at a time
+		void Interact(uint32_t begin, uint32_t end, InteractionList& list, float soft2,
+			float* ax, float* ay, float* az) const;
+	};
+}
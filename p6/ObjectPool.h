@@ -0,0 +1,88 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <new>
+#include <utility>
+#include <type_traits>
+#include <cstddef>
+
+namespace Physics {
+	//fixed address storage for objects that come and go every step, like particles
+	//memory is taken in blocks of BlockSize and never given back until the pool dies,
+	//freed slots go on a free list, so once the pool has grown to its peak Create never allocates
+	//objects keep their address for their whole life, so the world can hold raw pointers to them
+	template <typename T, size_t BlockSize = 256>
+	class ObjectPool {
+	public:
+		ObjectPool() {}
+		~ObjectPool() { Clear(); }
+
+		ObjectPool(const ObjectPool&) = delete;
+		ObjectPool& operator=(const ObjectPool&) = delete;
+
+		template <typename... Args>
+		T* Create(Args&&... args) {
+			if (!freeList) Grow();
+			Slot* slot = freeList;
+			T* object = new (&slot->storage) T(std::forward<Args>(args)...);
+			freeList = slot->nextFree;
+			slot->alive = true;
+			live++;
+			return object;
+		}
+
+		void Destroy(T* object) {
+			//storage is the first member so the object address is the slot address
+			Slot* slot = reinterpret_cast<Slot*>(object);
+			object->~T();
+			slot->alive = false;
+			slot->nextFree = freeList;
+			freeList = slot;
+			live--;
+		}
+
+		//visits every live object, in block order, not creation order
+		template <typename F>
+		void ForEach(F visit) const {
+			for (const auto& block : blocks) {
+				for (size_t i = 0; i < BlockSize; i++) {
+					if (block[i].alive) visit(*reinterpret_cast<const T*>(&block[i].storage));
+				}
+			}
+		}
+
+		void Clear() {
+			for (auto& block : blocks) {
+				for (size_t i = 0; i < BlockSize; i++) {
+					if (block[i].alive) Destroy(reinterpret_cast<T*>(&block[i].storage));
+				}
+			}
+		}
+
+		size_t Size() const { return live; }
+		bool Empty() const { return live == 0; }
+		size_t Capacity() const { return blocks.size() * BlockSize; }
+
+	private:
+		struct Slot {
+			typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+			Slot* nextFree;
+			bool alive;
+		};
+
+		void Grow() {
+			blocks.emplace_back(new Slot[BlockSize]);
+			Slot* block = blocks.back().get();
+			//threaded in reverse so the lowest address is handed out first
+			for (size_t i = BlockSize; i-- > 0;) {
+				block[i].alive = false;
+				block[i].nextFree = freeList;
+				freeList = &block[i];
+			}
+		}
+
+		std::vector<std::unique_ptr<Slot[]>> blocks;
+		Slot* freeList = nullptr;
+		size_t live = 0;
+	};
+}
@@ -0,0 +1,166 @@
+#include "ParticleBoundary.h"
+#include <cmath>
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#include <emmintrin.h>
+#define BOUNDARY_USE_SSE
+#endif
+
+namespace Physics {
+	PackedParticles PackedParticles::Gather(PhysicsParticle* const* particles, size_t count, FrameArena& arena) {
+		PackedParticles packed;
+		packed.particles = particles;
+		packed.count = count;
+		packed.x = arena.AllocateArray<float>(count);
+		packed.y = arena.AllocateArray<float>(count);
+		packed.z = arena.AllocateArray<float>(count);
+		packed.radius = arena.AllocateArray<float>(count);
+		for (size_t i = 0; i < count; i++) {
+			const PhysicsParticle* p = particles[i];
+			packed.x[i] = p->Position.x;
+			packed.y[i] = p->Position.y;
+			packed.z[i] = p->Position.z;
+			packed.radius[i] = p->radius;
+		}
+		return packed;
+	}
+
+	ParticleBoundary ParticleBoundary::Plane(const MyVector& normal, float offset) {
+		ParticleBoundary boundary;
+		float length = normal.Magnitude();
+		if (length > 0.0f) {
+			boundary.AddFace(normal.x / length, normal.y / length, normal.z / length, offset / length);
+		}
+		return boundary;
+	}
+
+	ParticleBoundary ParticleBoundary::Box(const MyVector& min, const MyVector& max) {
+		ParticleBoundary boundary;
+		boundary.AddFace(1, 0, 0, min.x);
+		boundary.AddFace(-1, 0, 0, -max.x);
+		boundary.AddFace(0, 1, 0, min.y);
+		boundary.AddFace(0, -1, 0, -max.y);
+		boundary.AddFace(0, 0, 1, min.z);
+		boundary.AddFace(0, 0, -1, -max.z);
+		return boundary;
+	}
+
+	void ParticleBoundary::AddFace(float nx, float ny, float nz, float offset) {
+		if (faceCount == MaxFaces) return;
+		faces[faceCount++] = Face{ nx, ny, nz, offset };
+	}
+
+	template <typename F>
+	void ParticleBoundary::ForEachPenetrating(const PackedParticles& packed, const F& handle) const {
+		size_t i = 0;
+#ifdef BOUNDARY_USE_SSE
+		//signed distance to every face for four particles at once, only the lanes that come out
+		//negative on some face leave the vector loop
+		const __m128 zero = _mm_setzero_ps();
+		for (; i + 4 <= packed.count; i += 4) {
+			__m128 x = _mm_loadu_ps(packed.x + i);
+			__m128 y = _mm_loadu_ps(packed.y + i);
+			__m128 z = _mm_loadu_ps(packed.z + i);
+			__m128 r = _mm_loadu_ps(packed.radius + i);
+
+			int masks[MaxFaces];
+			int any = 0;
+			for (size_t f = 0; f < faceCount; f++) {
+				const Face& face = faces[f];
+				__m128 d = _mm_mul_ps(x, _mm_set1_ps(face.nx));
+				d = _mm_add_ps(d, _mm_mul_ps(y, _mm_set1_ps(face.ny)));
+				d = _mm_add_ps(d, _mm_mul_ps(z, _mm_set1_ps(face.nz)));
+				d = _mm_sub_ps(d, _mm_add_ps(r, _mm_set1_ps(face.offset)));
+				masks[f] = _mm_movemask_ps(_mm_cmplt_ps(d, zero));
+				any |= masks[f];
+			}
+			if (!any) continue;
+
+			for (int lane = 0; lane < 4; lane++) {
+				if (!(any & (1 << lane))) continue;
+				unsigned int faceMask = 0;
+				for (size_t f = 0; f < faceCount; f++) {
+					faceMask |= ((masks[f] >> lane) & 1u) << f;
+				}
+				handle(i + lane, faceMask);
+			}
+		}
+#endif
+		for (; i < packed.count; i++) {
+			unsigned int faceMask = 0;
+			for (size_t f = 0; f < faceCount; f++) {
+				const Face& face = faces[f];
+				float d = face.nx * packed.x[i] + face.ny * packed.y[i] + face.nz * packed.z[i]
+					- packed.radius[i] - face.offset;
+				if (d < 0.0f) faceMask |= 1u << f;
+			}
+			if (faceMask) handle(i, faceMask);
+		}
+	}
+
+	size_t ParticleBoundary::Collide(const PackedParticles& packed, ArenaVector<ParticleContact>& contacts) const {
+		const size_t before = contacts.size();
+		ForEachPenetrating(packed, [&](size_t i, unsigned int faceMask) {
+			for (size_t f = 0; f < faceCount; f++) {
+				if (!(faceMask & (1u << f))) continue;
+				const Face& face = faces[f];
+				ParticleContact contact;
+				contact.particles[0] = packed.particles[i];
+				contact.particles[1] = nullptr;
+				contact.restitution = restitution;
+				contact.contactNormal = MyVector(face.nx, face.ny, face.nz);
+				contact.depth = face.offset + packed.radius[i]
+					- (face.nx * packed.x[i] + face.ny * packed.y[i] + face.nz * packed.z[i]);
+				contacts.push_back(contact);
+			}
+		});
+		return contacts.size() - before;
+	}
+
+	size_t ParticleBoundary::ResolveInPlace(const PackedParticles& packed) const {
+		size_t moved = 0;
+		ForEachPenetrating(packed, [&](size_t i, unsigned int faceMask) {
+			PhysicsParticle* particle = packed.particles[i];
+			for (size_t f = 0; f < faceCount; f++) {
+				if (!(faceMask & (1u << f))) continue;
+				const Face& face = faces[f];
+				MyVector normal(face.nx, face.ny, face.nz);
+
+				//same result a contact against static geometry resolves to, mass cancels out
+				float depth = face.offset + packed.radius[i]
+					- (face.nx * packed.x[i] + face.ny * packed.y[i] + face.nz * packed.z[i]);
+				if (depth > 0.0f) {
+					packed.x[i] += face.nx * depth;
+					packed.y[i] += face.ny * depth;
+					packed.z[i] += face.nz * depth;
+				}
+				float separatingSpeed = particle->Velocity.Dot(normal);
+				if (separatingSpeed < 0.0f) {
+					particle->Velocity += normal * (-(1.0f + restitution) * separatingSpeed);
+				}
+			}
+			particle->Position = MyVector(packed.x[i], packed.y[i], packed.z[i]);
+			moved++;
+		});
+		return moved;
+	}
+
+	bool ParticleBoundary::Sweep(const MyVector& from, const MyVector& to, float radius, float& time, MyVector& normal) const {
+		bool found = false;
+		for (size_t f = 0; f < faceCount; f++) {
+			const Face& face = faces[f];
+			float start = face.nx * from.x + face.ny * from.y + face.nz * from.z - radius - face.offset;
+			float end = face.nx * to.x + face.ny * to.y + face.nz * to.z - radius - face.offset;
+			if (start < 0.0f || end >= 0.0f) continue;
+
+			//distance to the face is linear along the path
+			float t = start / (start - end);
+			if (!found || t < time) {
+				time = t;
+				normal = MyVector(face.nx, face.ny, face.nz);
+				found = true;
+			}
+		}
+		return found;
+	}
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <cstddef>
+#include "PhysicsParticle.h"
+#include "ParticleContact.h"
+#include "FrameArena.h"
+
+namespace Physics {
+	//positions and radii of a batch of particles copied into flat arrays, so boundary tests
+	//can run four particles at a time, the arrays live in the arena they were gathered into
+	struct PackedParticles {
+		PhysicsParticle* const* particles = nullptr;
+		float* x = nullptr;
+		float* y = nullptr;
+		float* z = nullptr;
+		float* radius = nullptr;
+		size_t count = 0;
+
+		static PackedParticles Gather(PhysicsParticle* const* particles, size_t count, FrameArena& arena);
+	};
+
+	//analytic wall particles can not pass, either one infinite plane or the inside of a box
+	//a box is its six faces, all tested in the same pass so each particle is loaded once
+	class ParticleBoundary {
+	public:
+		//particles stay on the side normal points to, touching when normal . position == offset + radius
+		static ParticleBoundary Plane(const MyVector& normal, float offset);
+		//particles stay inside the box
+		static ParticleBoundary Box(const MyVector& min, const MyVector& max);
+
+		//appends a contact for every face a particle pokes through, returns how many were added
+		size_t Collide(const PackedParticles& packed, ArenaVector<ParticleContact>& contacts) const;
+		//pushes penetrating particles back onto the faces and bounces their velocity right away,
+		//no contacts are made, also updates packed so later boundaries see the new positions
+		//returns how many particles were moved
+		size_t ResolveInPlace(const PackedParticles& packed) const;
+
+		//moves a sphere from from to to and finds the first time in [0, 1] it crosses a face
+		//spheres already behind a face at the start are left to the discrete pass
+		bool Sweep(const MyVector& from, const MyVector& to, float radius, float& time, MyVector& normal) const;
+
+		//bounciness of the walls
+		void SetRestitution(float value) { restitution = value; }
+		float GetRestitution() const { return restitution; }
+
+		//the world calls ResolveInPlace instead of going through contacts when set
+		void SetResolveInPlace(bool value) { resolveInPlace = value; }
+		bool GetResolveInPlace() const { return resolveInPlace; }
+
+		//most contacts one particle can get from this boundary
+		size_t GetFaceCount() const { return faceCount; }
+
+	private:
+		static const size_t MaxFaces = 6;
+
+		//inside when nx * x + ny * y + nz * z - radius >= offset
+		struct Face {
+			float nx, ny, nz;
+			float offset;
+		};
+
+		Face faces[MaxFaces];
+		size_t faceCount = 0;
+		float restitution = 0.5f;
+		bool resolveInPlace = false;
+
+		ParticleBoundary() = default;
+		void AddFace(float nx, float ny, float nz, float offset);
+
+		//calls handle(index, faceMask) for every particle outside at least one face
+		template <typename F>
+		void ForEachPenetrating(const PackedParticles& packed, const F& handle) const;
+	};
+}
@@ -5,6 +5,7 @@ namespace Physics {
 	void  ParticleContact::Resolve(float time) {
 		//call resolve velocity
 		ResolveVelocity(time);
+		ResolveInterpenetration();
 	}
 	float ParticleContact::GetSeparatingSpeed() {
 		MyVector velocity = particles[0]->Velocity;
@@ -35,7 +36,23 @@ namespace Physics {
 
 		if (particles[1]) {
 			MyVector v_B = Impulse * ((float)1 / particles[1]->mass);
-			particles[1]->Velocity = particles[1]->Velocity + v_B;
+			particles[1]->Velocity = particles[1]->Velocity - v_B;
 		}
 	}
+
+	void ParticleContact::ResolveInterpenetration() {
+		if (depth <= 0) return;
+
+		float totalMass = (float)1 / particles[0]->mass;
+		if (particles[1]) totalMass += (float)1 / particles[1]->mass;
+		if (totalMass <= 0) return;
+
+		//lighter particle moves further
+		MyVector movePerMass = contactNormal * (depth / totalMass);
+		particles[0]->Position = particles[0]->Position + movePerMass * ((float)1 / particles[0]->mass);
+		if (particles[1]) {
+			particles[1]->Position = particles[1]->Position - movePerMass * ((float)1 / particles[1]->mass);
+		}
+		depth = 0;
+	}
 }
\ No newline at end of file
@@ -5,12 +5,14 @@
 namespace Physics {
 	class ParticleContact {
 	public:
-		//collding particles
-		PhysicsParticle* particles[2];
+		//collding particles, the second is null for static geometry
+		PhysicsParticle* particles[2] = { nullptr, nullptr };
 		//holds the coefficient of restitution
-		float restitution;
+		float restitution = 1.0f;
 		//contact normal of collision
 		MyVector contactNormal;
+		//how far they overlap along the normal, 0 when only touching
+		float depth = 0.0f;
 		//resolve ocntact
 		void Resolve(float time);
 
@@ -18,5 +20,7 @@ namespace Physics {
 		float GetSeparatingSpeed();
 
 		void ResolveVelocity(float time);
+		//pushes them apart by depth, split by inverse mass
+		void ResolveInterpenetration();
 	};
 }
@@ -0,0 +1,173 @@
+#include "ParticleEmitter.h"
+#include "ThreadPool.h"
+#include "AllocationAudit.h"
+#include <cmath>
+#include <algorithm>
+
+namespace Physics {
+	namespace {
+		const float Pi = 3.14159265f;
+
+		//random numbers used per particle on top of the direction, each gets its own plane in the scratch buffer
+		enum RandomPlane {
+			ShapeC, ShapeD,
+			SpeedPlane, ForcePlane, SizePlane, LifePlane,
+			RedPlane, GreenPlane, BluePlane,
+			PlaneCount
+		};
+
+		//two unit vectors perpendicular to axis and each other
+		void BuildBasis(const MyVector& axis, MyVector& tangent, MyVector& bitangent) {
+			MyVector helper = std::fabs(axis.y) < 0.99f ? MyVector(0, 1, 0) : MyVector(1, 0, 0);
+			tangent = helper.Cross(axis).Direction();
+			bitangent = axis.Cross(tangent);
+		}
+
+		//fills out[i] = min + (max - min) * u[i]
+		void Remap(const float* u, size_t count, const EmitterRange& range, float* out) {
+			const float span = range.max - range.min;
+			for (size_t i = 0; i < count; i++) out[i] = range.min + span * u[i];
+		}
+	}
+
+	void SpawnBatch::Resize(size_t count) {
+		px.resize(count); py.resize(count); pz.resize(count);
+		vx.resize(count); vy.resize(count); vz.resize(count);
+		fx.resize(count); fy.resize(count); fz.resize(count);
+		size.resize(count);
+		lifetime.resize(count);
+		color.resize(count);
+	}
+
+	ParticleEmitter::ParticleEmitter(const EmitterSettings& settings, uint64_t seed)
+		: settings(settings), seed(seed) {
+	}
+
+	size_t ParticleEmitter::Update(float deltaTime, SpawnBatch& batch, size_t capacity) {
+		accumulator += static_cast<double>(settings.rate) * deltaTime;
+		size_t due = static_cast<size_t>(accumulator);
+		accumulator -= static_cast<double>(due);
+
+		due += pendingBurst;
+		pendingBurst = 0;
+
+		Emit(std::min(due, capacity), batch);
+		return batch.Size();
+	}
+
+	void ParticleEmitter::Emit(size_t count, SpawnBatch& batch) {
+		AllocationScope scope("emitter");
+		batch.Resize(count);
+		if (count == 0) return;
+
+		//last call's chunks are all finished, so every thread's scratch is free again
+		scratch.Reset();
+
+		//stream id from the call number and chunk index, never from the thread
+		const uint64_t streamBase = (emitCount++) << 32;
+		auto body = [&](size_t first, size_t last) {
+			for (size_t chunk = first; chunk < last; chunk++) {
+				Random rng(seed, streamBase + chunk);
+				EmitChunk(rng, scratch.Local(), chunk * ChunkSize, std::min(count, (chunk + 1) * ChunkSize), batch);
+			}
+		};
+
+		const size_t chunks = (count + ChunkSize - 1) / ChunkSize;
+		if (chunks == 1) body(0, 1);
+		else ThreadPool::Shared().ParallelFor(chunks, 1, body);
+	}
+
+	void ParticleEmitter::EmitChunk(Random& rng, FrameArena& arena, size_t begin, size_t end, SpawnBatch& batch) const {
+		const size_t count = end - begin;
+
+		//arena belongs to the running thread so parallel chunks never share it
+		float* randoms = arena.AllocateArray<float>(count * PlaneCount);
+		rng.FillUniform(randoms, count * PlaneCount);
+		const float* plane[PlaneCount];
+		for (int p = 0; p < PlaneCount; p++) plane[p] = randoms + p * count;
+
+		MyVector axis = settings.axis.Magnitude() > 0.0f ? settings.axis.Direction() : MyVector(0, 1, 0);
+		MyVector tangent, bitangent;
+		BuildBasis(axis, tangent, bitangent);
+
+		//Point and Sphere use the whole sphere, Cone and Disc the configured half angle
+		float cosLimit = -1.0f;
+		if (settings.shape == EmitterSettings::Shape::Cone || settings.shape == EmitterSettings::Shape::Disc) {
+			cosLimit = std::cos(std::min(settings.coneAngle, Pi));
+		}
+		float* dirX = batch.vx.data() + begin;
+		float* dirY = batch.vy.data() + begin;
+		float* dirZ = batch.vz.data() + begin;
+		rng.FillConeDirections(dirX, dirY, dirZ, count, cosLimit);
+		//around +z so far, rotate onto the axis
+		for (size_t i = 0; i < count; i++) {
+			float lx = dirX[i], ly = dirY[i], lz = dirZ[i];
+			dirX[i] = tangent.x * lx + bitangent.x * ly + axis.x * lz;
+			dirY[i] = tangent.y * lx + bitangent.y * ly + axis.y * lz;
+			dirZ[i] = tangent.z * lx + bitangent.z * ly + axis.z * lz;
+		}
+
+		//start positions
+		float* px = batch.px.data() + begin;
+		float* py = batch.py.data() + begin;
+		float* pz = batch.pz.data() + begin;
+		float* size = batch.size.data() + begin;
+		const MyVector& origin = settings.origin;
+		switch (settings.shape) {
+		case EmitterSettings::Shape::Sphere:
+			//cube root keeps the ball evenly filled, the direction doubles as the offset
+			for (size_t i = 0; i < count; i++) {
+				float r = settings.radius * std::cbrt(plane[ShapeC][i]);
+				px[i] = origin.x + dirX[i] * r;
+				py[i] = origin.y + dirY[i] * r;
+				pz[i] = origin.z + dirZ[i] * r;
+			}
+			break;
+		case EmitterSettings::Shape::Disc: {
+			//square root keeps the disc evenly filled, size holds the sines until the size pass
+			float* cosines = batch.lifetime.data() + begin;
+			Random::SinCosTurns(plane[ShapeD], size, cosines, count);
+			for (size_t i = 0; i < count; i++) {
+				float r = settings.radius * std::sqrt(plane[ShapeC][i]);
+				float lx = r * cosines[i];
+				float ly = r * size[i];
+				px[i] = origin.x + tangent.x * lx + bitangent.x * ly;
+				py[i] = origin.y + tangent.y * lx + bitangent.y * ly;
+				pz[i] = origin.z + tangent.z * lx + bitangent.z * ly;
+			}
+			break;
+		}
+		default:
+			std::fill(px, px + count, origin.x);
+			std::fill(py, py + count, origin.y);
+			std::fill(pz, pz + count, origin.z);
+			break;
+		}
+
+		//scale the unit directions into forces and velocities
+		float* fx = batch.fx.data() + begin;
+		float* fy = batch.fy.data() + begin;
+		float* fz = batch.fz.data() + begin;
+		Remap(plane[ForcePlane], count, settings.force, size); //size used as scratch until the size pass
+		for (size_t i = 0; i < count; i++) {
+			fx[i] = dirX[i] * size[i];
+			fy[i] = dirY[i] * size[i];
+			fz[i] = dirZ[i] * size[i];
+		}
+		Remap(plane[SpeedPlane], count, settings.speed, size);
+		for (size_t i = 0; i < count; i++) {
+			dirX[i] *= size[i];
+			dirY[i] *= size[i];
+			dirZ[i] *= size[i];
+		}
+
+		Remap(plane[SizePlane], count, settings.size, size);
+		Remap(plane[LifePlane], count, settings.lifetime, batch.lifetime.data() + begin);
+
+		glm::vec3* color = batch.color.data() + begin;
+		const glm::vec3 colorSpan = settings.colorMax - settings.colorMin;
+		for (size_t i = 0; i < count; i++) {
+			color[i] = settings.colorMin + colorSpan * glm::vec3(plane[RedPlane][i], plane[GreenPlane][i], plane[BluePlane][i]);
+		}
+	}
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <vector>
+#include <random>
+#include <cstddef>
+#include <cstdint>
+#include "MyVector.h"
+#include "Random.h"
+#include "FrameArena.h"
+
+namespace Physics {
+	//min/max pair, values are drawn uniformly between them
+	struct EmitterRange {
+		float min;
+		float max;
+	};
+
+	//everything that decides where, how fast and how often particles come out
+	struct EmitterSettings {
+		//Point: all at the origin, any direction
+		//Sphere: inside a ball of radius, moving outward
+		//Cone: at the origin, inside coneAngle around axis
+		//Disc: on a disc of radius facing axis, inside coneAngle around it
+		enum class Shape { Point, Sphere, Cone, Disc };
+
+		Shape shape = Shape::Point;
+		MyVector origin = MyVector(0, 0, 0);
+		MyVector axis = MyVector(0, 1, 0);
+		float radius = 0.0f;
+		float coneAngle = 0.5f; //half angle in radians
+
+		float rate = 50.0f; //particles per second, fractions carry over between steps
+
+		EmitterRange speed = { 0.0f, 0.0f }; //initial velocity along the direction
+		EmitterRange force = { 0.0f, 0.0f }; //one off push along the direction, applied on the first step
+		EmitterRange size = { 1.0f, 1.0f };
+		EmitterRange lifetime = { 1.0f, 1.0f };
+		glm::vec3 colorMin = glm::vec3(0.0f);
+		glm::vec3 colorMax = glm::vec3(1.0f);
+	};
+
+	//freshly generated particles, one array per property so each pass is a flat loop
+	struct SpawnBatch {
+		std::vector<float> px, py, pz;
+		std::vector<float> vx, vy, vz;
+		std::vector<float> fx, fy, fz;
+		std::vector<float> size;
+		std::vector<float> lifetime;
+		std::vector<glm::vec3> color;
+
+		size_t Size() const { return px.size(); }
+		void Resize(size_t count);
+
+		MyVector Position(size_t i) const { return MyVector(px[i], py[i], pz[i]); }
+		MyVector Velocity(size_t i) const { return MyVector(vx[i], vy[i], vz[i]); }
+		MyVector Force(size_t i) const { return MyVector(fx[i], fy[i], fz[i]); }
+	};
+
+	class ParticleEmitter {
+	public:
+		//the same seed and settings give the same particles, however many threads generate them
+		explicit ParticleEmitter(const EmitterSettings& settings, uint64_t seed = std::random_device()());
+
+		//works out how many particles are due for this step and generates them into batch
+		//rate * time is accumulated so the total matches the rate at any step size,
+		//capacity caps the count and anything over it is dropped, not queued
+		size_t Update(float deltaTime, SpawnBatch& batch, size_t capacity = static_cast<size_t>(-1));
+
+		//adds count particles to the next Update on top of the rate
+		void Burst(size_t count) { pendingBurst += count; }
+
+		//generates exactly count particles into batch, replacing what was there
+		//large bursts are split into chunks on the shared thread pool
+		void Emit(size_t count, SpawnBatch& batch);
+
+		EmitterSettings& Settings() { return settings; }
+		const EmitterSettings& Settings() const { return settings; }
+
+	private:
+		EmitterSettings settings;
+		double accumulator = 0.0; //double so long runs do not drift
+		size_t pendingBurst = 0;
+
+		uint64_t seed;
+		uint64_t emitCount = 0; //feeds the stream ids so every Emit call gets fresh numbers
+
+		//random planes for each chunk, one arena per thread, rewound at the start of every Emit
+		FrameArenas scratch;
+
+		//particles per parallel chunk, each chunk has its own stream
+		static const size_t ChunkSize = 4096;
+
+		void EmitChunk(Random& rng, FrameArena& arena, size_t begin, size_t end, SpawnBatch& batch) const;
+	};
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <vector>
+#include "MyVector.h"
+
+namespace Physics {
+	//read only copy of everything the renderer needs from a simulation step
+	//kept as separate arrays so later passes can stream over them
+	struct ParticleSnapshot {
+		std::vector<float> x;
+		std::vector<float> y;
+		std::vector<float> z;
+		std::vector<float> scale;
+		std::vector<glm::vec3> color;
+		std::vector<float> alpha;
+
+		size_t Size() const { return x.size(); }
+
+		void Clear() {
+			x.clear();
+			y.clear();
+			z.clear();
+			scale.clear();
+			color.clear();
+			alpha.clear();
+		}
+
+		void Push(const MyVector& position, float size, const glm::vec3& tint, float opacity = 1.0f) {
+			x.push_back(position.x);
+			y.push_back(position.y);
+			z.push_back(position.z);
+			scale.push_back(size);
+			color.push_back(tint);
+			alpha.push_back(opacity);
+		}
+	};
+}
@@ -1,93 +1,141 @@
 #include "ParticleSystem.h"
+#include <algorithm>
 
 namespace Physics {
-    ParticleSystem::ParticleSystem(Shader* shader, PhysicsWorld* world, const MyVector& spawnPoint)
-        : shader(shader), world(world), spawnPoint(spawnPoint), gen(rd()),
-        colorDist(0.0f, 1.0f),
-        sizeDist(2.0f, 10.0f),
-        lifeDist(1.0f, 10.0f),
-        forceDist(1.0f, 3000.0f),
-        angleDist(0.0f, 2.0f * 3.14159265f) {
+    namespace {
+        //same mostly upward spray the old per call spawn produced, from the spawn point
+        EmitterSettings DefaultEmitter(const MyVector& spawnPoint) {
+            EmitterSettings settings;
+            settings.shape = EmitterSettings::Shape::Cone;
+            settings.origin = spawnPoint;
+            settings.axis = MyVector(0, 1, 0);
+            settings.coneAngle = 0.4f;
+            settings.rate = 0.0f;
+            settings.force = { 1.0f, 4500.0f };
+            settings.size = { 2.0f, 10.0f };
+            settings.lifetime = { 1.0f, 10.0f };
+            return settings;
+        }
+    }
+
+    ParticleSystem::ParticleSystem(Shader* shader, PhysicsWorld* world, const MyVector& spawnPoint, Shader* spriteShader)
+        : shader(shader), world(world), spawnPoint(spawnPoint), emitter(DefaultEmitter(spawnPoint)),
+        depthSorter(ThreadPool::Shared()) {
+        if (spriteShader) spriteBatch.reset(new SpriteBatch(*spriteShader));
     }
 
     //updates all particles and removes dead ones
     void ParticleSystem::Update(float deltaTime) {
-        particles.erase(
-            std::remove_if(particles.begin(), particles.end(),
-                [this, deltaTime](Particle& p) {
-                    p.lifetime -= deltaTime;
-                    if (p.lifetime <= 0) {
-                        world->RemoveParticle(&p.physics); //remove from  physics world
-                        return true; //mark for deletion
-                    }
-                    return false;
-                }),
-            particles.end()
-        );
+        //only what expired this step comes back, the world drops them all in one pass
+        lifetimes.Advance(deltaTime, expired);
+        if (!expired.empty()) {
+            for (auto it : expired) {
+                world->RemoveParticle(&it->physics); //remove from  physics world
+            }
+            world->FlushRemovals();
+            for (auto it : expired) {
+                particles.erase(it);
+            }
+            expired.clear();
+        }
+
+        //everything due this step comes out in one batch
+        if (emitter.Update(deltaTime, spawnBatch) > 0) Spawn(spawnBatch);
     }
 
-    //renderingg of all active particles
     void ParticleSystem::Render(const glm::mat4& view, const glm::mat4& projection) {
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        Render(view, projection, Frustum(projection * view), static_cast<float>(viewport[3]));
+    }
+
+    void ParticleSystem::Render(const MyCamera& camera) {
+        Render(camera.GetViewMatrix(), camera.GetProjectionMatrix(), camera.GetFrustum(), camera.GetViewportHeight());
+    }
+
+    void ParticleSystem::Render(const glm::mat4& view, const glm::mat4& projection, const Frustum& frustum, float viewportHeight) {
+        renderArena.Reset();
+        cullX.clear();
+        cullY.clear();
+        cullZ.clear();
+        cullRadius.clear();
+        cullParticles.clear();
         for (auto& particle : particles) {
-            particle.visual.SetPosition(particle.physics.Position);
-            particle.visual.Render(view, projection);
+            cullParticles.push_back(&particle);
+            MyVector scale = particle.visual.GetScale();
+            cullX.push_back(particle.physics.Position.x);
+            cullY.push_back(particle.physics.Position.y);
+            cullZ.push_back(particle.physics.Position.z);
+            //unit sphere mesh so the largest scale axis is the radius
+            cullRadius.push_back(std::max(scale.x, std::max(scale.y, scale.z)));
+        }
+
+        //only draw what is inside the camera, far to near so the fade blends correctly
+        frustum.CullSpheres(cullX.data(), cullY.data(), cullZ.data(), cullRadius.data(),
+            particles.size(), visibleIndices);
+        depthSorter.SortBackToFront(cullX.data(), cullY.data(), cullZ.data(), visibleIndices, view, renderArena);
+
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        glDepthMask(GL_FALSE);
+
+        if (renderMode == RenderMode::Sprite && spriteBatch) {
+            //everything visible goes out in one point sprite draw
+            spriteBatch->Clear();
+            for (uint32_t index : visibleIndices) {
+                const Particle& particle = *cullParticles[index];
+                spriteBatch->Add(glm::vec3(cullX[index], cullY[index], cullZ[index]), cullRadius[index],
+                    glm::vec4(particle.visual.GetColor(), lifetimes.LifeRatio(particle.birth, particle.death)));
+            }
+            spriteBatch->Draw(view, projection, viewportHeight);
         }
+        else {
+            //detail level per particle, kept in sorted order since blending depends on it
+            glm::mat4 viewProjection = projection * view;
+            float pixelScale = projection[1][1] * viewportHeight * 0.5f;
+            for (uint32_t index : visibleIndices) {
+                Particle& particle = *cullParticles[index];
+                float screenRadius = GameObject::ProjectedRadius(viewProjection, pixelScale,
+                    glm::vec3(cullX[index], cullY[index], cullZ[index]), cullRadius[index]);
+                particle.visual.SetPosition(particle.physics.Position);
+                particle.visual.SetAlpha(lifetimes.LifeRatio(particle.birth, particle.death));
+                particle.visual.Render(view, projection, particle.visual.SelectLod(screenRadius));
+            }
+        }
+
+        glDepthMask(GL_TRUE);
+        glDisable(GL_BLEND);
     }
 
     //creates and initializes a new particle
     void ParticleSystem::SpawnParticle() {
-        particles.emplace_back("3D/sphere.obj", *shader);
-        Particle& p = particles.back();
-
-        //initialize properties for physics
-        p.physics.Position = MyVector(0, 0, 0);
-        p.physics.mass = 1.0f;
-        p.physics.Damping = 0.9f;
-        p.physics.Velocity = MyVector(0, 0, 0);
-        p.physics.ResetForce();
-
-        //calculate random direction for force
-        float theta = angleDist(gen);
-        float phi = angleDist(gen) * 0.25f;
-        float forceMagnitude = forceDist(gen);
-
-        //onvert spherical coordinates to force vector
-        float sinPhi = sin(phi);
-        float cosPhi = cos(phi);
-        MyVector forceDirection(
-            sinPhi * cos(theta) * 0.3f,
-            cosPhi * 1.5f,
-            sinPhi * sin(theta) * 0.3f
-        );
-
-        p.physics.AddForce(forceDirection * forceMagnitude); //applying of force
-
-        float size = sizeDist(gen);
-        p.visual.SetScale(MyVector(size, size, size));
-        p.visual.SetColor(glm::vec4(GetRandomColor(), 1.0f));
-
-        // Set lifetime
-        p.maxLifetime = lifeDist(gen);
-        p.lifetime = p.maxLifetime;
-
-        world->AddParticle(&p.physics);
+        emitter.Emit(1, spawnBatch);
+        Spawn(spawnBatch);
     }
 
-    //generates a random force vector (mostly upward)
-    MyVector ParticleSystem::GetRandomForce() {
-        return MyVector(
-            (colorDist(gen) - 0.5f) * 100.0f,
-            2500.0f,
-            (colorDist(gen) - 0.5f) * 100.0f
-        );
-    }
+    //turns a generated batch into live particles registered with the world
+    void ParticleSystem::Spawn(const SpawnBatch& batch) {
+        for (size_t i = 0; i < batch.Size(); i++) {
+            particles.emplace_back("3D/sphere.obj", *shader);
+            Particle& p = particles.back();
+
+            //initialize properties for physics
+            p.physics.Position = batch.Position(i);
+            p.physics.mass = 1.0f;
+            p.physics.Damping = 0.9f;
+            p.physics.Velocity = batch.Velocity(i);
+            p.physics.ResetForce();
+            p.physics.AddForce(batch.Force(i)); //applying of force
+
+            float size = batch.size[i];
+            p.visual.SetScale(MyVector(size, size, size));
+            p.visual.SetColor(batch.color[i]);
 
-    //generates a random RGB color
-    glm::vec3 ParticleSystem::GetRandomColor() {
-        return glm::vec3(
-            colorDist(gen), //red
-            colorDist(gen), //green
-            colorDist(gen)  //blue
-        );
+            // Set lifetime
+            p.birth = lifetimes.Now();
+            p.death = lifetimes.Add(std::prev(particles.end()), batch.lifetime[i]);
+
+            world->AddParticle(&p.physics);
+        }
     }
-}
\ No newline at end of file
+}
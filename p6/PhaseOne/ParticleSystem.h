@@ -2,7 +2,13 @@
 #include "../../GameObject.h"
 #include "../PhysicsParticle.h"
 #include "../PhysicsWorld.h"
-#include <random>
+#include "../../Camera/MyCamera.h"
+#include "../../SpriteBatch.h"
+#include "../../DepthSorter.h"
+#include "../ParticleEmitter.h"
+#include "../LifetimeWheel.h"
+#include <memory>
+#include <list>
 
 namespace Physics {
     class ParticleSystem {
@@ -10,35 +16,57 @@ namespace Physics {
         struct Particle {
             PhysicsParticle physics;
             GameObject visual;
-            float lifetime;
-            float maxLifetime;
+            float birth; //absolute times on the system's lifetime wheel
+            float death;
 
             Particle(const std::string& modelPath, Shader& shader)
-                : visual(modelPath, shader), lifetime(0), maxLifetime(0) {
+                : visual(modelPath, shader), birth(0), death(0) {
             }
         };
 
-        ParticleSystem(Shader* shader, PhysicsWorld* world, const MyVector& spawnPoint);
+        //Mesh draws the sphere model per particle, Sprite streams every particle into one point sprite draw
+        enum class RenderMode { Mesh, Sprite };
+
+        //spriteShader is only needed for RenderMode::Sprite
+        ParticleSystem(Shader* shader, PhysicsWorld* world, const MyVector& spawnPoint, Shader* spriteShader = nullptr);
+        //ages and removes particles, then spawns whatever the emitter has due for this step
         void Update(float deltaTime);
         void Render(const glm::mat4& view, const glm::mat4& projection);
+        //uses the camera's cached matrices and frustum
+        void Render(const MyCamera& camera);
         void SpawnParticle();
+        //spawns count extra particles on the next Update
+        void Burst(size_t count) { emitter.Burst(count); }
+
+        //shape, rate and distributions, rate starts at 0 so nothing spawns until it is set
+        ParticleEmitter& GetEmitter() { return emitter; }
+
+        void SetRenderMode(RenderMode mode) { renderMode = mode; }
+        RenderMode GetRenderMode() const { return renderMode; }
 
     private:
         Shader* shader;
         PhysicsWorld* world;
         MyVector spawnPoint;
-        std::vector<Particle> particles;
+        std::list<Particle> particles; //list so the world's particle pointers stay valid
+        ParticleEmitter emitter;
+        SpawnBatch spawnBatch; //reused every step
+
+        //expiry buckets so Update only touches particles that die this step
+        LifetimeWheel<std::list<Particle>::iterator> lifetimes;
+        std::vector<std::list<Particle>::iterator> expired;
 
+        RenderMode renderMode = RenderMode::Mesh;
+        std::unique_ptr<SpriteBatch> spriteBatch;
 
-        std::random_device rd;
-        std::mt19937 gen;
-        std::uniform_real_distribution<float> colorDist;
-        std::uniform_real_distribution<float> sizeDist;
-        std::uniform_real_distribution<float> lifeDist;
-        std::uniform_real_distribution<float> forceDist;
-        std::uniform_real_distribution<float> angleDist;
+        //scratch arrays for culling, kept around so they only grow
+        std::vector<float> cullX, cullY, cullZ, cullRadius;
+        std::vector<Particle*> cullParticles;
+        std::vector<uint32_t> visibleIndices;
+        DepthSorter depthSorter;
+        FrameArena renderArena; //sort buffers, rewound every Render
 
-        MyVector GetRandomForce();
-        glm::vec3 GetRandomColor();
+        void Render(const glm::mat4& view, const glm::mat4& projection, const Frustum& frustum, float viewportHeight);
+        void Spawn(const SpawnBatch& batch);
     };
 }
\ No newline at end of file
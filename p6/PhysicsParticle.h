@@ -17,6 +17,8 @@ namespace Physics {
 		MyVector Acceleration;
 		//approx drag
 		float Damping = 0.9f;
+		//collision sphere against colliders
+		float radius = 1.0f;
 
 		void AddForce(MyVector force);
 
@@ -1,4 +1,6 @@
 #include "PhysicsWorld.h"
+#include <algorithm>
+#include "AllocationAudit.h"
 
 using namespace Physics;
 
@@ -6,41 +8,157 @@ void PhysicsWorld::AddParticle(PhysicsParticle* toAdd)
 {
 	Particles.push_back(toAdd);
 
-	//affected by gravity immedietly
-	forceRegistry.Add(toAdd, &Gravity);
+	//affected by gravity immedietly, the pipeline has it otherwise
+	if (!Pipeline) forceRegistry.Add(toAdd, &Gravity);
+}
+
+void PhysicsWorld::SetForcePipeline(ForcePipelineBase* pipeline)
+{
+	if (pipeline && !Pipeline) {
+		forceRegistry.RemoveGenerator(&Gravity);
+	}
+	else if (!pipeline && Pipeline) {
+		for (PhysicsParticle* p : Particles) {
+			forceRegistry.Add(p, &Gravity);
+		}
+	}
+	Pipeline = pipeline;
+}
+
+void PhysicsWorld::AddCollider(const MeshCollider* collider)
+{
+	Colliders.push_back(collider);
+}
+
+void PhysicsWorld::RemoveCollider(const MeshCollider* collider)
+{
+	Colliders.erase(std::remove(Colliders.begin(), Colliders.end(), collider), Colliders.end());
+}
+
+void PhysicsWorld::AddBoundary(const ParticleBoundary* boundary)
+{
+	Boundaries.push_back(boundary);
+}
+
+void PhysicsWorld::RemoveBoundary(const ParticleBoundary* boundary)
+{
+	Boundaries.erase(std::remove(Boundaries.begin(), Boundaries.end(), boundary), Boundaries.end());
+}
+
+void PhysicsWorld::AddFluid(SphFluid* fluid)
+{
+	Fluids.push_back(fluid);
+}
+
+void PhysicsWorld::RemoveFluid(SphFluid* fluid)
+{
+	Fluids.erase(std::remove(Fluids.begin(), Fluids.end(), fluid), Fluids.end());
 }
 
 void PhysicsWorld::Update(float time)
 {
+	AllocationScope scope("physics");
+
+	//last step's scratch is dead, reuse it
+	StepArenas.Reset();
+
 	//update list first
-	UpdateParticleList();
+	FlushRemovals();
 
+	if (Pipeline) Pipeline->Apply(Particles.data(), Particles.size(), time);
 	forceRegistry.UpdateForces(time);
+	for (SphFluid* fluid : Fluids) {
+		fluid->ApplyForces(StepArenas.Local());
+	}
 
-	//create iterator dor the start of the list
-	for (std::list<PhysicsParticle*>::iterator p = Particles.begin();
-		//continue looping until end of the list
-		p != Particles.end();
-		//move to next particle
-		p++
-		)
+	//paths for the sweep start where the particles are now
+	PackedParticles start;
+	if (UseContinuousCollision && !Particles.empty()) {
+		start = PackedParticles::Gather(Particles.data(), Particles.size(), StepArenas.Local());
+	}
+
+	for (PhysicsParticle* p : Particles)
 	{
-		(*p)->Update(time);
+		p->Update(time);
+	}
+
+	if (start.count > 0) {
+		Ccd.Resolve(start, time, Colliders.data(), Colliders.size(), Boundaries.data(), Boundaries.size(), StepArenas.Local());
 	}
 
+	ResolveContacts(time);
+
 }
 
-void PhysicsWorld::UpdateParticleList() {
+void PhysicsWorld::ResolveContacts(float time) {
+	if ((Colliders.empty() && Boundaries.empty()) || Particles.empty()) return;
+
+	FrameArena& scratch = StepArenas.Local();
+	//grows with the contacts actually found, most particles touch nothing, so sizing for one
+	//contact per particle per face would burn arena on slots that stay empty
+	ArenaVector<ParticleContact> contacts{ ArenaAllocator<ParticleContact>(scratch) };
+
+	if (!Boundaries.empty()) {
+		//positions are gathered once and shared by every boundary
+		PackedParticles packed = PackedParticles::Gather(Particles.data(), Particles.size(), scratch);
+		//in place boundaries go first and update packed, so every contact below is measured from
+		//the corrected positions instead of correcting the same penetration a second time
+		for (const ParticleBoundary* boundary : Boundaries) {
+			if (boundary->GetResolveInPlace()) boundary->ResolveInPlace(packed);
+		}
+		for (const ParticleBoundary* boundary : Boundaries) {
+			if (!boundary->GetResolveInPlace()) boundary->Collide(packed, contacts);
+		}
+	}
+
+	for (const MeshCollider* collider : Colliders) {
+		collider->Collide(Particles.data(), Particles.size(), scratch, contacts);
+	}
+
+	for (ParticleContact& contact : contacts) {
+		contact.Resolve(time);
+	}
+}
+
+void PhysicsWorld::FlushRemovals() {
+	//the registry only needs a pass when something actually died
+	if (UpdateParticleList() > 0) {
+		forceRegistry.RemoveDestroyed();
+		for (SphFluid* fluid : Fluids) {
+			fluid->RemoveDestroyed();
+		}
+	}
+}
+
+size_t PhysicsWorld::UpdateParticleList() {
 	//Removes all particles in the list that
 	//return true to the function below
-
-	Particles.remove_if(
+	auto alive = std::remove_if(Particles.begin(), Particles.end(),
 		//checks all the particles int the list
 		//if isDestroyed flag is true
 		[](PhysicsParticle* p) {
 			return p->IsDestroyed();
 		}
 	);
+	size_t removed = Particles.end() - alive;
+	Particles.erase(alive, Particles.end());
+	return removed;
 }
 
+ParticleSnapshot& PhysicsWorld::BeginSnapshot() {
+	ParticleSnapshot& snapshot = Snapshots.WriteBuffer();
+	snapshot.Clear();
+	return snapshot;
+}
+
+void PhysicsWorld::PublishSnapshot() {
+	Snapshots.Publish();
+}
 
+bool PhysicsWorld::AcquireSnapshot() {
+	return Snapshots.Acquire();
+}
+
+const ParticleSnapshot& PhysicsWorld::GetSnapshot() const {
+	return Snapshots.ReadBuffer();
+}
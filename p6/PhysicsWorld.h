@@ -1,8 +1,17 @@
 #pragma once
 #include <list>
+#include <vector>
 #include "PhysicsParticle.h"
 #include "ForceRegistry.h"
 #include "GravityForceGenerator.h"
+#include "ForcePipeline.h"
+#include "ParticleSnapshot.h"
+#include "TripleBuffer.h"
+#include "FrameArena.h"
+#include "MeshCollider.h"
+#include "ParticleBoundary.h"
+#include "ContinuousCollision.h"
+#include "SphFluid.h"
 
 namespace Physics {
 
@@ -15,22 +24,82 @@ namespace Physics {
 		std::list<PhysicsParticle*> Links;
 
 		//The list of ALL our particles
-		std::list<PhysicsParticle*> Particles;
+		std::vector<PhysicsParticle*> Particles;
 
 		//Function to add particles to the list
 		void AddParticle(PhysicsParticle* toAdd);
 
+		//forces for every particle run as one fused pass before the registry, the world does not own it
+		//replaces the built in gravity, put a GravityForceGenerator in the pipeline to keep it
+		//null goes back to gravity through the registry
+		void SetForcePipeline(ForcePipelineBase* pipeline);
+
+		//static geometry every particle collides with after it moves, the world does not own it
+		void AddCollider(const MeshCollider* collider);
+		void RemoveCollider(const MeshCollider* collider);
+
+		//floors and walls, tested against every particle after it moves, the world does not own them
+		void AddBoundary(const ParticleBoundary* boundary);
+		void RemoveBoundary(const ParticleBoundary* boundary);
+
+		//fluids whose pressure and viscosity are added after the other forces, the world does not own them
+		//their particles have to be added to the world as well
+		void AddFluid(SphFluid* fluid);
+		void RemoveFluid(SphFluid* fluid);
+
+		//sweeps particles that move further than their size in a step instead of letting them
+		//pass through colliders and each other, slow particles stay on the discrete path
+		void SetContinuousCollision(bool enabled) { UseContinuousCollision = enabled; }
+		bool GetContinuousCollision() const { return UseContinuousCollision; }
+		ContinuousCollision& GetContinuousCollisionSettings() { return Ccd; }
+
 		//Universal update function to call the updates of All
 		void Update(float time);
 
+		//marks the particle dead, it leaves the world and every registry entry on the next
+		//FlushRemovals or Update, so it has to stay alive until then
 		void RemoveParticle(PhysicsParticle* particle) {
-			Particles.remove(particle);
+			particle->Destroy();
 		}
+
+		//drops every destroyed particle and its force entries in one pass each
+		//call after marking a batch dead and before freeing them
+		void FlushRemovals();
+
+		//scratch for anything built during a step, one arena per thread
+		//rewound at the start of every Update, so nothing in it outlives the step
+		FrameArenas& GetStepArenas() { return StepArenas; }
+
+		//snapshot the simulation thread is filling, cleared on every call
+		ParticleSnapshot& BeginSnapshot();
+		//publishes the filled snapshot to the render thread
+		void PublishSnapshot();
+		//render thread side, swaps in the newest snapshot if there is one
+		bool AcquireSnapshot();
+		//last snapshot acquired by the render thread
+		const ParticleSnapshot& GetSnapshot() const;
 	private:
-		//Updates the particle list
-		void UpdateParticleList();
+		//Updates the particle list, returns how many were removed
+		size_t UpdateParticleList();
+
+		//finds every particle touching a collider or boundary and resolves it, contacts live in the step arena
+		void ResolveContacts(float time);
+
+		std::vector<const MeshCollider*> Colliders;
+		std::vector<const ParticleBoundary*> Boundaries;
+		std::vector<SphFluid*> Fluids;
+
+		ForcePipelineBase* Pipeline = nullptr;
+
+		ContinuousCollision Ccd;
+		bool UseContinuousCollision = false;
 		                                                                //-9.8f for gravity
 		GravityForceGenerator Gravity = GravityForceGenerator(MyVector(0,-9.8f , 0));
 
+		//sim -> render hand off
+		TripleBuffer<ParticleSnapshot> Snapshots;
+
+		FrameArenas StepArenas;
+
 	};
 }
\ No newline at end of file
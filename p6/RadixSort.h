@@ -0,0 +1,150 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include <utility>
+#include "ThreadPool.h"
+#include "FrameArena.h"
+
+namespace Physics {
+	//LSD radix sort on unsigned integer keys, 8 bits per pass, stable
+	//values (usually indices) are carried along with their keys
+	//passes where every key has the same digit are skipped, so short keys cost less
+	//the scratch arrays need room for count entries each
+	template <typename Key>
+	void RadixSortPairs(Key* keys, uint32_t* values, Key* keyScratch, uint32_t* valueScratch, size_t count)
+	{
+		if (count < 2) return;
+
+		Key* srcKeys = keys;
+		uint32_t* srcValues = values;
+		Key* dstKeys = keyScratch;
+		uint32_t* dstValues = valueScratch;
+
+		for (unsigned int shift = 0; shift < sizeof(Key) * 8; shift += 8) {
+			size_t histogram[256] = { 0 };
+			for (size_t i = 0; i < count; i++) {
+				histogram[(srcKeys[i] >> shift) & 0xFF]++;
+			}
+
+			//every key in one bucket, this digit does not change the order
+			if (histogram[(srcKeys[0] >> shift) & 0xFF] == count) continue;
+
+			size_t offset = 0;
+			for (size_t& bucket : histogram) {
+				size_t size = bucket;
+				bucket = offset;
+				offset += size;
+			}
+
+			for (size_t i = 0; i < count; i++) {
+				size_t slot = histogram[(srcKeys[i] >> shift) & 0xFF]++;
+				dstKeys[slot] = srcKeys[i];
+				dstValues[slot] = srcValues[i];
+			}
+
+			std::swap(srcKeys, dstKeys);
+			std::swap(srcValues, dstValues);
+		}
+
+		//odd number of real passes leaves the result in the scratch buffers
+		if (srcKeys != keys) {
+			std::memcpy(keys, srcKeys, count * sizeof(Key));
+			std::memcpy(values, srcValues, count * sizeof(uint32_t));
+		}
+	}
+
+	//vector form, grows the scratch vectors to fit
+	template <typename Key>
+	void RadixSortPairs(std::vector<Key>& keys, std::vector<uint32_t>& values,
+		std::vector<Key>& keyScratch, std::vector<uint32_t>& valueScratch)
+	{
+		keyScratch.resize(keys.size());
+		valueScratch.resize(keys.size());
+		RadixSortPairs(keys.data(), values.data(), keyScratch.data(), valueScratch.data(), keys.size());
+	}
+
+	//same sort split over the pool, each pass builds per chunk histograms in parallel,
+	//turns them into per chunk write offsets and scatters every chunk in parallel
+	//chunks are written in order so it stays stable, small inputs fall back to RadixSortPairs
+	//the histograms come out of arena
+	template <typename Key>
+	void ParallelRadixSortPairs(ThreadPool& pool, FrameArena& arena, Key* keys, uint32_t* values,
+		Key* keyScratch, uint32_t* valueScratch, size_t count, size_t minChunk = 16384)
+	{
+		const size_t chunkCount = std::min<size_t>(pool.GetThreadCount() + 1, count / minChunk);
+		if (chunkCount < 2) {
+			RadixSortPairs(keys, values, keyScratch, valueScratch, count);
+			return;
+		}
+		const size_t chunkSize = (count + chunkCount - 1) / chunkCount;
+
+		Key* srcKeys = keys;
+		uint32_t* srcValues = values;
+		Key* dstKeys = keyScratch;
+		uint32_t* dstValues = valueScratch;
+
+		//chunk major, 256 counters per chunk
+		size_t* histograms = arena.AllocateArray<size_t>(chunkCount * 256);
+
+		for (unsigned int shift = 0; shift < sizeof(Key) * 8; shift += 8) {
+			pool.ParallelFor(chunkCount, 1, [&](size_t first, size_t last) {
+				for (size_t chunk = first; chunk < last; chunk++) {
+					size_t* histogram = &histograms[chunk * 256];
+					std::fill(histogram, histogram + 256, 0);
+					const size_t end = std::min(count, (chunk + 1) * chunkSize);
+					for (size_t i = chunk * chunkSize; i < end; i++) {
+						histogram[(srcKeys[i] >> shift) & 0xFF]++;
+					}
+				}
+			});
+
+			//digit by digit, chunk by chunk, so chunk 0's keys land before chunk 1's with the same digit
+			size_t offset = 0;
+			bool uniform = false;
+			for (size_t digit = 0; digit < 256; digit++) {
+				size_t start = offset;
+				for (size_t chunk = 0; chunk < chunkCount; chunk++) {
+					size_t size = histograms[chunk * 256 + digit];
+					histograms[chunk * 256 + digit] = offset;
+					offset += size;
+				}
+				if (offset - start == count) uniform = true;
+			}
+			//every key in one bucket, this digit does not change the order
+			if (uniform) continue;
+
+			pool.ParallelFor(chunkCount, 1, [&](size_t first, size_t last) {
+				for (size_t chunk = first; chunk < last; chunk++) {
+					size_t* histogram = &histograms[chunk * 256];
+					const size_t end = std::min(count, (chunk + 1) * chunkSize);
+					for (size_t i = chunk * chunkSize; i < end; i++) {
+						size_t slot = histogram[(srcKeys[i] >> shift) & 0xFF]++;
+						dstKeys[slot] = srcKeys[i];
+						dstValues[slot] = srcValues[i];
+					}
+				}
+			});
+
+			std::swap(srcKeys, dstKeys);
+			std::swap(srcValues, dstValues);
+		}
+
+		//odd number of real passes leaves the result in the scratch buffers
+		if (srcKeys != keys) {
+			std::memcpy(keys, srcKeys, count * sizeof(Key));
+			std::memcpy(values, srcValues, count * sizeof(uint32_t));
+		}
+	}
+
+	//maps a float to an unsigned int that sorts in the same order
+	inline uint32_t FloatToSortableBits(float value)
+	{
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		//negative floats flip all bits, positive ones only the sign
+		return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+	}
+}
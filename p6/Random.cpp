@@ -0,0 +1,218 @@
+#include "Random.h"
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#include <emmintrin.h>
+#define RANDOM_USE_SSE
+#endif
+
+namespace Physics {
+	namespace {
+		const float TwoPi = 6.28318530718f;
+
+		//spreads one 64 bit seed into well mixed state words, recommended seeder for xoshiro
+		uint64_t SplitMix64(uint64_t& x) {
+			uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+			return z ^ (z >> 31);
+		}
+
+		inline uint32_t Rotl(uint32_t x, int k) {
+			return (x << k) | (x >> (32 - k));
+		}
+
+		//top 23 bits into the mantissa of a float in [1, 2), minus one
+		inline float ToUnitFloat(uint32_t bits) {
+			uint32_t pattern = (bits >> 9) | 0x3F800000u;
+			float f;
+			std::memcpy(&f, &pattern, sizeof(f));
+			return f - 1.0f;
+		}
+
+		//odd polynomial for sin(2 pi t), t already folded into [-0.25, 0.25]
+		inline float SinFolded(float t) {
+			float x = t * TwoPi;
+			float x2 = x * x;
+			return x * (1.0f + x2 * (-1.6666667e-1f + x2 * (8.3333333e-3f + x2 * (-1.9841270e-4f
+				+ x2 * (2.7557319e-6f + x2 * -2.5052108e-8f)))));
+		}
+
+		//maps any turn count to [-0.25, 0.25] with the same sine
+		inline float FoldTurns(float t) {
+			t -= std::floor(t + 0.5f); //[-0.5, 0.5)
+			if (t > 0.25f) t = 0.5f - t;
+			else if (t < -0.25f) t = -0.5f - t;
+			return t;
+		}
+
+#ifdef RANDOM_USE_SSE
+		inline __m128i RotlSse(__m128i x, int k) {
+			return _mm_or_si128(_mm_slli_epi32(x, k), _mm_srli_epi32(x, 32 - k));
+		}
+
+		inline __m128 FoldTurnsSse(__m128 t) {
+			//floor(t + 0.5) via truncation, corrected for negatives
+			__m128 shifted = _mm_add_ps(t, _mm_set1_ps(0.5f));
+			__m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(shifted));
+			__m128 floored = _mm_sub_ps(truncated, _mm_and_ps(_mm_cmplt_ps(shifted, truncated), _mm_set1_ps(1.0f)));
+			t = _mm_sub_ps(t, floored);
+
+			__m128 high = _mm_cmpgt_ps(t, _mm_set1_ps(0.25f));
+			__m128 low = _mm_cmplt_ps(t, _mm_set1_ps(-0.25f));
+			__m128 mirrored = _mm_sub_ps(_mm_or_ps(_mm_and_ps(high, _mm_set1_ps(0.5f)), _mm_and_ps(low, _mm_set1_ps(-0.5f))), t);
+			__m128 flip = _mm_or_ps(high, low);
+			return _mm_or_ps(_mm_and_ps(flip, mirrored), _mm_andnot_ps(flip, t));
+		}
+
+		inline __m128 SinFoldedSse(__m128 t) {
+			__m128 x = _mm_mul_ps(t, _mm_set1_ps(TwoPi));
+			__m128 x2 = _mm_mul_ps(x, x);
+			__m128 p = _mm_set1_ps(-2.5052108e-8f);
+			p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(2.7557319e-6f));
+			p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(-1.9841270e-4f));
+			p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(8.3333333e-3f));
+			p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(-1.6666667e-1f));
+			p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(1.0f));
+			return _mm_mul_ps(p, x);
+		}
+#endif
+	}
+
+	Random::Random(uint64_t seed, uint64_t stream) {
+		Seed(seed, stream);
+	}
+
+	void Random::Seed(uint64_t seed, uint64_t stream) {
+		//stream picks a different starting point, mixed in so neighbouring streams look unrelated
+		uint64_t x = seed ^ (stream * 0xD1B54A32D192ED03ULL);
+		SplitMix64(x);
+		for (int i = 0; i < 4; i += 2) {
+			uint64_t v = SplitMix64(x);
+			state[i] = static_cast<uint32_t>(v);
+			state[i + 1] = static_cast<uint32_t>(v >> 32);
+		}
+		for (int lane = 0; lane < 4; lane++) {
+			for (int word = 0; word < 4; word += 2) {
+				uint64_t v = SplitMix64(x);
+				lanes[word][lane] = static_cast<uint32_t>(v);
+				lanes[word + 1][lane] = static_cast<uint32_t>(v >> 32);
+			}
+		}
+	}
+
+	uint32_t Random::NextUint() {
+		const uint32_t result = state[0] + state[3];
+		const uint32_t t = state[1] << 9;
+		state[2] ^= state[0];
+		state[3] ^= state[1];
+		state[1] ^= state[2];
+		state[0] ^= state[3];
+		state[2] ^= t;
+		state[3] = Rotl(state[3], 11);
+		return result;
+	}
+
+	float Random::NextFloat() {
+		return ToUnitFloat(NextUint());
+	}
+
+	void Random::FillUniform(float* out, size_t count) {
+		size_t i = 0;
+#ifdef RANDOM_USE_SSE
+		__m128i s0 = _mm_load_si128(reinterpret_cast<const __m128i*>(lanes[0]));
+		__m128i s1 = _mm_load_si128(reinterpret_cast<const __m128i*>(lanes[1]));
+		__m128i s2 = _mm_load_si128(reinterpret_cast<const __m128i*>(lanes[2]));
+		__m128i s3 = _mm_load_si128(reinterpret_cast<const __m128i*>(lanes[3]));
+		const __m128i exponent = _mm_set1_epi32(0x3F800000);
+		const __m128 one = _mm_set1_ps(1.0f);
+		while (i < count) {
+			__m128i result = _mm_add_epi32(s0, s3);
+			__m128i t = _mm_slli_epi32(s1, 9);
+			s2 = _mm_xor_si128(s2, s0);
+			s3 = _mm_xor_si128(s3, s1);
+			s1 = _mm_xor_si128(s1, s2);
+			s0 = _mm_xor_si128(s0, s3);
+			s2 = _mm_xor_si128(s2, t);
+			s3 = RotlSse(s3, 11);
+
+			__m128 values = _mm_sub_ps(_mm_castsi128_ps(_mm_or_si128(_mm_srli_epi32(result, 9), exponent)), one);
+			if (count - i >= 4) {
+				_mm_storeu_ps(out + i, values);
+				i += 4;
+			}
+			else {
+				//tail still advances all four lanes so the sequence matches the scalar path
+				alignas(16) float rest[4];
+				_mm_store_ps(rest, values);
+				for (int lane = 0; i < count; lane++) out[i++] = rest[lane];
+			}
+		}
+		_mm_store_si128(reinterpret_cast<__m128i*>(lanes[0]), s0);
+		_mm_store_si128(reinterpret_cast<__m128i*>(lanes[1]), s1);
+		_mm_store_si128(reinterpret_cast<__m128i*>(lanes[2]), s2);
+		_mm_store_si128(reinterpret_cast<__m128i*>(lanes[3]), s3);
+#else
+		while (i < count) {
+			float values[4];
+			for (int lane = 0; lane < 4; lane++) {
+				uint32_t* s[4] = { &lanes[0][lane], &lanes[1][lane], &lanes[2][lane], &lanes[3][lane] };
+				const uint32_t result = *s[0] + *s[3];
+				const uint32_t t = *s[1] << 9;
+				*s[2] ^= *s[0];
+				*s[3] ^= *s[1];
+				*s[1] ^= *s[2];
+				*s[0] ^= *s[3];
+				*s[2] ^= t;
+				*s[3] = Rotl(*s[3], 11);
+				values[lane] = ToUnitFloat(result);
+			}
+			for (int lane = 0; lane < 4 && i < count; lane++) out[i++] = values[lane];
+		}
+#endif
+	}
+
+	void Random::FillRange(float* out, size_t count, float min, float max) {
+		FillUniform(out, count);
+		const float span = max - min;
+		for (size_t i = 0; i < count; i++) out[i] = min + span * out[i];
+	}
+
+	void Random::FillConeDirections(float* x, float* y, float* z, size_t count, float cosLimit) {
+		//z gets the polar uniforms and x the azimuth turns, then both are overwritten in place
+		FillUniform(z, count);
+		FillUniform(x, count);
+		SinCosTurns(x, y, x, count);
+
+		const float span = 1.0f - cosLimit;
+		for (size_t i = 0; i < count; i++) {
+			float cosTheta = 1.0f - z[i] * span;
+			float sinTheta = std::sqrt(std::max(0.0f, 1.0f - cosTheta * cosTheta));
+			x[i] *= sinTheta;
+			y[i] *= sinTheta;
+			z[i] = cosTheta;
+		}
+	}
+
+	void Random::SinCosTurns(const float* turns, float* sines, float* cosines, size_t count) {
+		size_t i = 0;
+#ifdef RANDOM_USE_SSE
+		const __m128 quarter = _mm_set1_ps(0.25f);
+		for (; i + 4 <= count; i += 4) {
+			__m128 t = _mm_loadu_ps(turns + i);
+			//read before writing, turns may alias cosines
+			__m128 s = SinFoldedSse(FoldTurnsSse(t));
+			__m128 c = SinFoldedSse(FoldTurnsSse(_mm_add_ps(t, quarter)));
+			_mm_storeu_ps(sines + i, s);
+			_mm_storeu_ps(cosines + i, c);
+		}
+#endif
+		for (; i < count; i++) {
+			float t = turns[i];
+			sines[i] = SinFolded(FoldTurns(t));
+			cosines[i] = SinFolded(FoldTurns(t + 0.25f));
+		}
+	}
+}
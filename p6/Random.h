@@ -0,0 +1,36 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+namespace Physics {
+	//xoshiro128+ generator, 16 bytes of state per stream and no divisions or tables
+	//batch calls run four independent lanes side by side (SSE2 when available, same numbers either way)
+	//the same seed and stream always give the same sequence, so giving every parallel chunk
+	//its own stream keeps results identical no matter which thread runs it
+	class Random {
+	public:
+		explicit Random(uint64_t seed = 0x853C49E6748FEA9BULL, uint64_t stream = 0);
+		void Seed(uint64_t seed, uint64_t stream = 0);
+
+		uint32_t NextUint();
+		//[0, 1)
+		float NextFloat();
+		float Range(float min, float max) { return min + (max - min) * NextFloat(); }
+
+		//count floats in [0, 1)
+		void FillUniform(float* out, size_t count);
+		void FillRange(float* out, size_t count, float min, float max);
+
+		//unit directions around +z, cosLimit is the cos of the cone half angle, -1 gives the whole sphere
+		//cos of the polar angle is uniform so the cap is covered evenly, no rejection loop
+		void FillConeDirections(float* x, float* y, float* z, size_t count, float cosLimit);
+
+		//sin and cos of 2 * pi * turns with a polynomial, about 1e-7 off for turns in [0, 1)
+		static void SinCosTurns(const float* turns, float* sines, float* cosines, size_t count);
+
+	private:
+		uint32_t state[4];
+		//batch lanes stored word major so one load picks up the same word of all four lanes
+		alignas(16) uint32_t lanes[4][4];
+	};
+}
@@ -0,0 +1,280 @@
+#include "SphFluid.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include "CellHash.h"
+#include "ThreadPool.h"
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#include <emmintrin.h>
+#define SPH_USE_SSE
+#endif
+
+namespace Physics {
+	namespace {
+		const float Pi = 3.14159265f;
+
+		//fewer particles than this are not worth handing to the pool
+		const size_t MinParticlesPerChunk = 256;
+
+		//one particle per entry, in cell list order
+		struct Sorted {
+			float* x;
+			float* y;
+			float* z;
+			float* vx;
+			float* vy;
+			float* vz;
+			float* mass;
+			float* density;
+			float* pressure; //pressure / density^2, what the force pass needs
+		};
+
+		//the buckets of the 27 cells around a cell, hashes that land in the same bucket are only
+		//listed once so nobody is counted twice
+		struct Neighbourhood {
+			int cell[3];
+			uint32_t bucket[27];
+			int count;
+		};
+
+		void FindNeighbourhood(const int cell[3], uint32_t tableMask, Neighbourhood& hood) {
+			hood.cell[0] = cell[0];
+			hood.cell[1] = cell[1];
+			hood.cell[2] = cell[2];
+			hood.count = 0;
+			for (int x = -1; x <= 1; x++) {
+				for (int y = -1; y <= 1; y++) {
+					for (int z = -1; z <= 1; z++) {
+						uint32_t bucket = CellHash(cell[0] + x, cell[1] + y, cell[2] + z) & tableMask;
+						bool seen = false;
+						for (int k = 0; k < hood.count && !seen; k++) seen = hood.bucket[k] == bucket;
+						if (!seen) hood.bucket[hood.count++] = bucket;
+					}
+				}
+			}
+		}
+
+#ifdef SPH_USE_SSE
+		//lanes whose index is below end
+		__m128 LanesBefore(uint32_t first, uint32_t end) {
+			__m128i index = _mm_add_epi32(_mm_set1_epi32(static_cast<int>(first)), _mm_set_epi32(3, 2, 1, 0));
+			return _mm_castsi128_ps(_mm_cmplt_epi32(index, _mm_set1_epi32(static_cast<int>(end))));
+		}
+
+		float Sum(__m128 v) {
+			alignas(16) float lanes[4];
+			_mm_store_ps(lanes, v);
+			return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+		}
+#endif
+	}
+
+	void SphFluid::RemoveDestroyed() {
+		particles.erase(std::remove_if(particles.begin(), particles.end(),
+			[](PhysicsParticle* p) { return p->IsDestroyed(); }), particles.end());
+	}
+
+	void SphFluid::ApplyForces(FrameArena& scratch) {
+		const size_t count = particles.size();
+		if (count < 2) return;
+		const float h = smoothingRadius;
+		const float h2 = h * h;
+		const float inverseCell = 1.0f / h;
+
+		//kernels from Muller et al. 2003, poly6 for density, spiky gradient for pressure,
+		//viscosity laplacian for viscosity, both of the last two share 45 / (pi h^6)
+		const float poly6 = 315.0f / (64.0f * Pi * std::pow(h, 9.0f));
+		const float spiky = 45.0f / (Pi * std::pow(h, 6.0f));
+
+		//hashed cell lists, counting sorted so each bucket's particles sit together
+		uint32_t tableSize = 1;
+		while (tableSize < count * 2) tableSize <<= 1;
+		const uint32_t tableMask = tableSize - 1;
+		int* cells = scratch.AllocateArray<int>(count * 3);
+		uint32_t* bucket = scratch.AllocateArray<uint32_t>(count);
+		uint32_t* bucketStart = scratch.AllocateArray<uint32_t>(tableSize + 1);
+		std::memset(bucketStart, 0, sizeof(uint32_t) * (tableSize + 1));
+		for (size_t i = 0; i < count; i++) {
+			const MyVector& p = particles[i]->Position;
+			int* cell = cells + i * 3;
+			cell[0] = static_cast<int>(std::floor(p.x * inverseCell));
+			cell[1] = static_cast<int>(std::floor(p.y * inverseCell));
+			cell[2] = static_cast<int>(std::floor(p.z * inverseCell));
+			bucket[i] = CellHash(cell[0], cell[1], cell[2]) & tableMask;
+			bucketStart[bucket[i] + 1]++;
+		}
+		for (uint32_t b = 0; b < tableSize; b++) bucketStart[b + 1] += bucketStart[b];
+
+		//everything the passes read is copied in bucket order, so a bucket is one run of memory
+		//three zeroed entries on the end let the last group of four load past it, those lanes
+		//are masked off
+		const size_t padded = count + 3;
+		Sorted s;
+		float** arrays[] = { &s.x, &s.y, &s.z, &s.vx, &s.vy, &s.vz, &s.mass, &s.density, &s.pressure };
+		for (float** array : arrays) {
+			*array = scratch.AllocateArray<float>(padded);
+			std::memset(*array + count, 0, sizeof(float) * 3);
+		}
+		uint32_t* order = scratch.AllocateArray<uint32_t>(count);
+		int* sortedCells = scratch.AllocateArray<int>(count * 3);
+		uint32_t* fill = scratch.AllocateArray<uint32_t>(tableSize);
+		std::memcpy(fill, bucketStart, sizeof(uint32_t) * tableSize);
+		for (size_t i = 0; i < count; i++) {
+			const uint32_t k = fill[bucket[i]]++;
+			const PhysicsParticle* p = particles[i];
+			s.x[k] = p->Position.x;
+			s.y[k] = p->Position.y;
+			s.z[k] = p->Position.z;
+			s.vx[k] = p->Velocity.x;
+			s.vy[k] = p->Velocity.y;
+			s.vz[k] = p->Velocity.z;
+			s.mass[k] = p->mass;
+			order[k] = static_cast<uint32_t>(i);
+			std::memcpy(sortedCells + k * 3, cells + i * 3, sizeof(int) * 3);
+		}
+
+		ThreadPool& pool = ThreadPool::Shared();
+		const float rest = restDensity;
+		const float k = stiffness;
+
+		//density and pressure
+		pool.ParallelFor(count, MinParticlesPerChunk, [&](size_t begin, size_t end) {
+			Neighbourhood hood;
+			hood.count = -1;
+			for (size_t i = begin; i < end; i++) {
+				const int* cell = sortedCells + i * 3;
+				//particles of one cell are next to each other, they share the bucket list
+				if (hood.count < 0 || cell[0] != hood.cell[0] || cell[1] != hood.cell[1] || cell[2] != hood.cell[2]) {
+					FindNeighbourhood(cell, tableMask, hood);
+				}
+				const float px = s.x[i], py = s.y[i], pz = s.z[i];
+				float density = 0.0f;
+#ifdef SPH_USE_SSE
+				const __m128 vx = _mm_set1_ps(px), vy = _mm_set1_ps(py), vz = _mm_set1_ps(pz);
+				const __m128 vh2 = _mm_set1_ps(h2);
+				__m128 sum = _mm_setzero_ps();
+				for (int b = 0; b < hood.count; b++) {
+					const uint32_t last = bucketStart[hood.bucket[b] + 1];
+					for (uint32_t j = bucketStart[hood.bucket[b]]; j < last; j += 4) {
+						__m128 dx = _mm_sub_ps(_mm_loadu_ps(s.x + j), vx);
+						__m128 dy = _mm_sub_ps(_mm_loadu_ps(s.y + j), vy);
+						__m128 dz = _mm_sub_ps(_mm_loadu_ps(s.z + j), vz);
+						__m128 r2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+						__m128 inside = _mm_and_ps(_mm_cmplt_ps(r2, vh2), LanesBefore(j, last));
+						__m128 w = _mm_sub_ps(vh2, r2);
+						w = _mm_mul_ps(_mm_mul_ps(w, w), w);
+						sum = _mm_add_ps(sum, _mm_and_ps(_mm_mul_ps(w, _mm_loadu_ps(s.mass + j)), inside));
+					}
+				}
+				density = Sum(sum);
+#else
+				for (int b = 0; b < hood.count; b++) {
+					const uint32_t last = bucketStart[hood.bucket[b] + 1];
+					for (uint32_t j = bucketStart[hood.bucket[b]]; j < last; j++) {
+						float dx = s.x[j] - px, dy = s.y[j] - py, dz = s.z[j] - pz;
+						float r2 = dx * dx + dy * dy + dz * dz;
+						if (r2 >= h2) continue;
+						float w = h2 - r2;
+						density += w * w * w * s.mass[j];
+					}
+				}
+#endif
+				density *= poly6;
+				s.density[i] = density;
+				//no pull below rest density, a loose spray should not clump into droplets
+				float pressure = std::max(k * (density - rest), 0.0f);
+				s.pressure[i] = density > 0.0f ? pressure / (density * density) : 0.0f;
+			}
+		});
+
+		//pressure pushes apart, viscosity evens out velocities, m (p_i / rho_i^2 + p_j / rho_j^2)
+		//keeps the pair's forces equal and opposite
+		const float mu = viscosity;
+		pool.ParallelFor(count, MinParticlesPerChunk, [&](size_t begin, size_t end) {
+			Neighbourhood hood;
+			hood.count = -1;
+			for (size_t i = begin; i < end; i++) {
+				const int* cell = sortedCells + i * 3;
+				if (hood.count < 0 || cell[0] != hood.cell[0] || cell[1] != hood.cell[1] || cell[2] != hood.cell[2]) {
+					FindNeighbourhood(cell, tableMask, hood);
+				}
+				const float px = s.x[i], py = s.y[i], pz = s.z[i];
+				const float pvx = s.vx[i], pvy = s.vy[i], pvz = s.vz[i];
+				const float ownPressure = s.pressure[i];
+				float ax = 0, ay = 0, az = 0; //pressure
+				float bx = 0, by = 0, bz = 0; //viscosity, still to be divided by density
+#ifdef SPH_USE_SSE
+				const __m128 vx = _mm_set1_ps(px), vy = _mm_set1_ps(py), vz = _mm_set1_ps(pz);
+				const __m128 wx = _mm_set1_ps(pvx), wy = _mm_set1_ps(pvy), wz = _mm_set1_ps(pvz);
+				const __m128 vh = _mm_set1_ps(h), vh2 = _mm_set1_ps(h2);
+				const __m128 own = _mm_set1_ps(ownPressure);
+				const __m128 zero = _mm_setzero_ps();
+				const __m128 half = _mm_set1_ps(0.5f), threeHalves = _mm_set1_ps(1.5f);
+				__m128 sax = zero, say = zero, saz = zero, sbx = zero, sby = zero, sbz = zero;
+				for (int b = 0; b < hood.count; b++) {
+					const uint32_t last = bucketStart[hood.bucket[b] + 1];
+					for (uint32_t j = bucketStart[hood.bucket[b]]; j < last; j += 4) {
+						__m128 dx = _mm_sub_ps(_mm_loadu_ps(s.x + j), vx);
+						__m128 dy = _mm_sub_ps(_mm_loadu_ps(s.y + j), vy);
+						__m128 dz = _mm_sub_ps(_mm_loadu_ps(s.z + j), vz);
+						__m128 r2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+						//itself and particles on exactly the same spot have no direction to push
+						__m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmplt_ps(r2, vh2), _mm_cmpgt_ps(r2, zero)), LanesBefore(j, last));
+						if (_mm_movemask_ps(inside) == 0) continue;
+
+						//1 / r from an estimate and one newton step
+						__m128 inverse = _mm_rsqrt_ps(_mm_max_ps(r2, _mm_set1_ps(1e-12f)));
+						inverse = _mm_mul_ps(inverse, _mm_sub_ps(threeHalves, _mm_mul_ps(_mm_mul_ps(half, r2), _mm_mul_ps(inverse, inverse))));
+						__m128 gap = _mm_sub_ps(vh, _mm_mul_ps(r2, inverse)); //h - r
+						__m128 mass = _mm_and_ps(_mm_loadu_ps(s.mass + j), inside);
+
+						//toward j is -gradient, so pressure pushes along -d
+						__m128 push = _mm_mul_ps(_mm_mul_ps(mass, _mm_add_ps(own, _mm_loadu_ps(s.pressure + j))),
+							_mm_mul_ps(_mm_mul_ps(gap, gap), inverse));
+						sax = _mm_sub_ps(sax, _mm_mul_ps(dx, push));
+						say = _mm_sub_ps(say, _mm_mul_ps(dy, push));
+						saz = _mm_sub_ps(saz, _mm_mul_ps(dz, push));
+
+						//masked lanes have no mass, their density may be 0 so it is swapped for 1
+						__m128 density = _mm_loadu_ps(s.density + j);
+						__m128 valid = _mm_and_ps(inside, _mm_cmpgt_ps(density, zero));
+						density = _mm_or_ps(_mm_and_ps(valid, density), _mm_andnot_ps(valid, _mm_set1_ps(1.0f)));
+						__m128 drag = _mm_div_ps(_mm_mul_ps(mass, gap), density);
+						sbx = _mm_add_ps(sbx, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(s.vx + j), wx), drag));
+						sby = _mm_add_ps(sby, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(s.vy + j), wy), drag));
+						sbz = _mm_add_ps(sbz, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(s.vz + j), wz), drag));
+					}
+				}
+				ax = Sum(sax); ay = Sum(say); az = Sum(saz);
+				bx = Sum(sbx); by = Sum(sby); bz = Sum(sbz);
+#else
+				for (int b = 0; b < hood.count; b++) {
+					const uint32_t last = bucketStart[hood.bucket[b] + 1];
+					for (uint32_t j = bucketStart[hood.bucket[b]]; j < last; j++) {
+						float dx = s.x[j] - px, dy = s.y[j] - py, dz = s.z[j] - pz;
+						float r2 = dx * dx + dy * dy + dz * dz;
+						if (r2 >= h2 || r2 <= 0.0f || s.density[j] <= 0.0f) continue;
+						float r = std::sqrt(r2);
+						float gap = h - r;
+						float push = s.mass[j] * (ownPressure + s.pressure[j]) * gap * gap / r;
+						ax -= dx * push;
+						ay -= dy * push;
+						az -= dz * push;
+						float drag = s.mass[j] * gap / s.density[j];
+						bx += (s.vx[j] - pvx) * drag;
+						by += (s.vy[j] - pvy) * drag;
+						bz += (s.vz[j] - pvz) * drag;
+					}
+				}
+#endif
+				//acceleration times mass, the world's integrator divides it back out
+				const float density = s.density[i];
+				const float drag = density > 0.0f ? mu / density : 0.0f;
+				const float m = s.mass[i] * spiky;
+				particles[order[i]]->AddForce(MyVector((ax + bx * drag) * m, (ay + by * drag) * m, (az + bz * drag) * m));
+			}
+		});
+	}
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include "PhysicsParticle.h"
+#include "FrameArena.h"
+
+namespace Physics {
+	//smoothed particle hydrodynamics, pressure and viscosity between particles that make them
+	//flow like a liquid, the particles stay ordinary world particles, this only adds forces
+	//so gravity, colliders, boundaries and the world's integrator all still apply
+	//neighbours come from hashed cell lists one smoothing radius wide, counting sorted so each
+	//cell's particles sit together and are read four at a time
+	class SphFluid {
+	public:
+		//particles further apart than the smoothing radius do not affect each other
+		explicit SphFluid(float smoothingRadius = 4.0f) { SetSmoothingRadius(smoothingRadius); }
+
+		//a fluid particle is a world particle too, add it to both, the fluid does not own it
+		//PhysicsWorld::FlushRemovals drops destroyed ones from every fluid added to the world
+		void AddParticle(PhysicsParticle* particle) { particles.push_back(particle); }
+		void RemoveDestroyed();
+		size_t GetParticleCount() const { return particles.size(); }
+
+		void SetSmoothingRadius(float value) { smoothingRadius = value > 1e-4f ? value : 1e-4f; }
+		float GetSmoothingRadius() const { return smoothingRadius; }
+
+		//mass per unit volume the fluid settles at, pressure pushes back above it
+		void SetRestDensity(float value) { restDensity = value; }
+		float GetRestDensity() const { return restDensity; }
+
+		//pressure per unit of density over rest, higher is less squashy but needs smaller steps
+		void SetStiffness(float value) { stiffness = value; }
+		float GetStiffness() const { return stiffness; }
+
+		//how strongly neighbours drag each other's velocity together
+		void SetViscosity(float value) { viscosity = value; }
+		float GetViscosity() const { return viscosity; }
+
+		//adds this step's pressure and viscosity forces, the world calls it before integrating
+		void ApplyForces(FrameArena& scratch);
+
+	private:
+		std::vector<PhysicsParticle*> particles;
+		float smoothingRadius;
+		float restDensity = 0.1f;
+		float stiffness = 1000.0f;
+		float viscosity = 3.0f;
+	};
+}
@@ -0,0 +1,199 @@
+#include "ThreadPool.h"
+#include <atomic>
+#include <algorithm>
+#include "AllocationAudit.h"
+
+using namespace Physics;
+
+//helpers and the caller pull chunk numbers from a shared counter
+//a helper that starts late just finds nothing left, and one that never started is taken
+//back out of the queue, so the state is free again as soon as ParallelFor returns
+struct ThreadPool::ForState {
+	std::atomic<size_t> next{ 0 };
+	std::atomic<size_t> done{ 0 };
+	size_t helpers = 0; //queued or running helpers, guarded by doneMutex
+	size_t chunks = 0;
+	size_t chunkSize = 0;
+	size_t count = 0;
+	ChunkFunction function = nullptr;
+	const void* body = nullptr;
+	const char* scope = nullptr; //caller's allocation scope, so helper allocations are blamed on it
+	std::mutex doneMutex;
+	std::condition_variable allDone;
+};
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+{
+	if (threadCount == 0) {
+		unsigned int cores = std::thread::hardware_concurrency();
+		threadCount = cores > 1 ? cores - 1 : 1;
+	}
+
+	for (unsigned int i = 0; i < threadCount; i++) {
+		workers.emplace_back([this]() { WorkerLoop(); });
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		stopping = true;
+	}
+	wakeUp.notify_all();
+
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+
+	//ParallelFor hands its state back before returning, so every one is on the free list
+	for (ForState* state : freeStates) {
+		delete state;
+	}
+}
+
+ThreadPool& ThreadPool::Shared()
+{
+	static ThreadPool pool;
+	return pool;
+}
+
+void ThreadPool::Enqueue(Task task)
+{
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		if (taskCount == tasks.size()) {
+			//unwrap the ring into a bigger one, oldest first
+			std::vector<Task> grown(std::max<size_t>(16, tasks.size() * 2));
+			for (size_t i = 0; i < taskCount; i++) {
+				grown[i] = std::move(tasks[(taskHead + i) % tasks.size()]);
+			}
+			tasks.swap(grown);
+			taskHead = 0;
+		}
+		tasks[(taskHead + taskCount) % tasks.size()] = std::move(task);
+		taskCount++;
+	}
+	wakeUp.notify_one();
+}
+
+void ThreadPool::WorkerLoop()
+{
+	while (true) {
+		Task task;
+		{
+			std::unique_lock<std::mutex> lock(queueMutex);
+			wakeUp.wait(lock, [this]() { return stopping || taskCount > 0; });
+			//drain what is left before leaving
+			if (stopping && taskCount == 0) return;
+			task = std::move(tasks[taskHead]);
+			tasks[taskHead] = Task();
+			taskHead = (taskHead + 1) % tasks.size();
+			taskCount--;
+		}
+		//helpers revoked by their ParallelFor come through empty
+		if (task.parallelFor) RunHelper(task.parallelFor);
+		else if (task.function) task.function();
+	}
+}
+
+ThreadPool::ForState* ThreadPool::AcquireState()
+{
+	{
+		std::lock_guard<std::mutex> lock(stateMutex);
+		if (!freeStates.empty()) {
+			ForState* state = freeStates.back();
+			freeStates.pop_back();
+			return state;
+		}
+	}
+	//only when ParallelFor calls nest deeper than ever before
+	return new ForState();
+}
+
+void ThreadPool::ReleaseState(ForState* state)
+{
+	std::lock_guard<std::mutex> lock(stateMutex);
+	freeStates.push_back(state);
+}
+
+void ThreadPool::RunChunks(ForState* state)
+{
+	AllocationScope scope(state->scope);
+	size_t chunk;
+	while ((chunk = state->next.fetch_add(1)) < state->chunks) {
+		size_t begin = chunk * state->chunkSize;
+		size_t end = std::min(begin + state->chunkSize, state->count);
+		if (begin < end) state->function(state->body, begin, end);
+
+		if (state->done.fetch_add(1) + 1 == state->chunks) {
+			std::lock_guard<std::mutex> lock(state->doneMutex);
+			state->allDone.notify_all();
+		}
+	}
+}
+
+void ThreadPool::RunHelper(ForState* state)
+{
+	RunChunks(state);
+	//notify under the lock, the caller may reuse the state the moment it sees zero
+	std::lock_guard<std::mutex> lock(state->doneMutex);
+	state->helpers--;
+	state->allDone.notify_all();
+}
+
+void ThreadPool::RunParallelFor(size_t count, size_t minChunk, ChunkFunction function, const void* body)
+{
+	if (count == 0) return;
+	if (minChunk == 0) minChunk = 1;
+
+	size_t maxChunks = (count + minChunk - 1) / minChunk;
+	size_t chunks = std::min(maxChunks, static_cast<size_t>(workers.size()) + 1);
+	if (chunks <= 1) {
+		function(body, 0, count);
+		return;
+	}
+
+	ForState* state = AcquireState();
+	state->next = 0;
+	state->done = 0;
+	state->helpers = chunks - 1;
+	state->chunks = chunks;
+	state->chunkSize = (count + chunks - 1) / chunks;
+	state->count = count;
+	state->function = function;
+	state->body = body;
+	state->scope = AllocationScope::Current();
+
+	for (size_t i = 1; i < chunks; i++) {
+		Task helper;
+		helper.parallelFor = state;
+		Enqueue(std::move(helper));
+	}
+	RunChunks(state);
+
+	{
+		std::unique_lock<std::mutex> lock(state->doneMutex);
+		state->allDone.wait(lock, [state]() { return state->done.load() == state->chunks; });
+	}
+
+	//every chunk is done, helpers still in the queue would find nothing, so take them back out
+	//the ones already running only have to notice the counter is spent, waiting on them is safe
+	size_t revoked = 0;
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		for (size_t i = 0; i < taskCount; i++) {
+			Task& task = tasks[(taskHead + i) % tasks.size()];
+			if (task.parallelFor == state) {
+				task.parallelFor = nullptr;
+				revoked++;
+			}
+		}
+	}
+	{
+		std::unique_lock<std::mutex> lock(state->doneMutex);
+		state->helpers -= revoked;
+		state->allDone.wait(lock, [state]() { return state->helpers == 0; });
+	}
+	ReleaseState(state);
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+
+namespace Physics {
+	//fixed set of worker threads fed from one task queue
+	class ThreadPool {
+	public:
+		//0 picks one thread per core minus the caller, at least one
+		explicit ThreadPool(unsigned int threadCount = 0);
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		//queues a task and returns a future for its result
+		template <typename F>
+		auto Submit(F task) -> std::future<decltype(task())> {
+			typedef decltype(task()) Result;
+			auto packaged = std::make_shared<std::packaged_task<Result()>>(std::move(task));
+			std::future<Result> result = packaged->get_future();
+			Task queued;
+			queued.function = [packaged]() { (*packaged)(); };
+			Enqueue(std::move(queued));
+			return result;
+		}
+
+		//splits [0, count) into chunks of at least minChunk and runs body(begin, end) on them
+		//the calling thread works on chunks too and returns once every chunk is done,
+		//so it is safe to call from inside another pool task
+		//body is passed by pointer to the helpers, so nothing is copied to the heap
+		template <typename F>
+		void ParallelFor(size_t count, size_t minChunk, const F& body) {
+			RunParallelFor(count, minChunk, &InvokeChunk<F>, &body);
+		}
+
+		unsigned int GetThreadCount() const { return static_cast<unsigned int>(workers.size()); }
+
+		//pool shared by systems that do not need their own
+		static ThreadPool& Shared();
+
+	private:
+		typedef void (*ChunkFunction)(const void* body, size_t begin, size_t end);
+
+		template <typename F>
+		static void InvokeChunk(const void* body, size_t begin, size_t end) {
+			(*static_cast<const F*>(body))(begin, end);
+		}
+
+		//shared by the caller and helpers of one ParallelFor, recycled instead of freed
+		struct ForState;
+
+		//either a submitted function or a ParallelFor helper, helpers need no std::function
+		struct Task {
+			std::function<void()> function;
+			ForState* parallelFor = nullptr;
+		};
+
+		void RunParallelFor(size_t count, size_t minChunk, ChunkFunction function, const void* body);
+		static void RunChunks(ForState* state);
+		static void RunHelper(ForState* state);
+		ForState* AcquireState();
+		void ReleaseState(ForState* state);
+
+		void Enqueue(Task task);
+		void WorkerLoop();
+
+		std::vector<std::thread> workers;
+		//ring buffer, only grows when more tasks are waiting than ever before
+		std::vector<Task> tasks;
+		size_t taskHead = 0;
+		size_t taskCount = 0;
+		std::mutex queueMutex;
+		std::condition_variable wakeUp;
+		bool stopping = false;
+
+		std::vector<ForState*> freeStates;
+		std::mutex stateMutex;
+	};
+}
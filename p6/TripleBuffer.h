@@ -0,0 +1,38 @@
+#pragma once
+#include <atomic>
+
+namespace Physics {
+	//lock free triple buffer for one writer thread and one reader thread
+	//the writer always has a free buffer to fill, the reader always sees the newest full one
+	template <typename T>
+	class TripleBuffer {
+	public:
+		//buffer owned by the writer
+		T& WriteBuffer() { return buffers[writeIndex]; }
+
+		//hands the write buffer over to the reader and takes back a free one
+		void Publish() {
+			writeIndex = pending.exchange(writeIndex | DirtyBit) & IndexMask;
+		}
+
+		//swaps in the newest published buffer, returns false if nothing new was published
+		bool Acquire() {
+			if ((pending.load() & DirtyBit) == 0) return false;
+			readIndex = pending.exchange(readIndex) & IndexMask;
+			return true;
+		}
+
+		//buffer owned by the reader
+		const T& ReadBuffer() const { return buffers[readIndex]; }
+
+	private:
+		static const int IndexMask = 0x3;
+		static const int DirtyBit = 0x4;
+
+		T buffers[3];
+		int writeIndex = 0;
+		int readIndex = 1;
+		//index of the buffer in between, with the dirty bit set when it holds unread data
+		std::atomic<int> pending{ 2 };
+	};
+}